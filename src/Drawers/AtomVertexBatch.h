@@ -0,0 +1,129 @@
+#ifndef PHYSICSSIMULATION_ATOMVERTEXBATCH_H
+#define PHYSICSSIMULATION_ATOMVERTEXBATCH_H
+
+#include "Atom.h"
+#include "ParticleStorage.h"
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Vertices of all visible atoms built in one pass over the particle arrays, so that a frame takes
+// one draw call instead of one per atom.
+// Atoms are textured quads; when they are smaller than a couple of pixels on the screen the texture
+// is not visible anyway, so they become single points. Atoms outside the visible area are skipped.
+class AtomVertexBatch {
+private:
+    // only grows, so that vertices are not initialized again every frame; the first getVerticesCount() are used
+    std::vector<sf::Vertex> m_vertices;
+    size_t m_vertices_count{0};
+    bool m_is_using_points{false};
+    size_t m_atoms_count{0};
+
+    float m_radius;
+    float m_texture_size;
+
+    // atoms with a smaller radius on the screen are drawn as points
+    static constexpr float MIN_RADIUS_PIXELS = 1.5f;
+
+public:
+    explicit AtomVertexBatch(float radius = 5.f, unsigned int texture_size = 64) :
+            m_radius(radius), m_texture_size((float) texture_size) {}
+
+    static sf::Color getColor(double vx, double vy) {
+        return {(sf::Uint8) std::clamp(std::sqrt(vx * vx + vy * vy) * 5, 0., 255.), 0, 0};
+    }
+
+    // a white disc with a smooth edge, the color of every atom comes from its vertices
+    static sf::Image createAtomImage(unsigned int size = 64) {
+        sf::Image image;
+        image.create(size, size, sf::Color::Transparent);
+
+        float center = (float) size / 2.f;
+
+        for (unsigned int x = 0; x < size; ++x) {
+            for (unsigned int y = 0; y < size; ++y) {
+                float distance = std::hypot((float) x + 0.5f - center, (float) y + 0.5f - center);
+                float alpha = std::clamp(center - distance, 0.f, 1.f);
+
+                image.setPixel(x, y, sf::Color(255, 255, 255, (sf::Uint8) (alpha * 255)));
+            }
+        }
+
+        return image;
+    }
+
+    // visible_area is in world coordinates, pixel_size is the length of a screen pixel in them
+    void build(const ParticleStorage &atoms, const sf::FloatRect &visible_area, float pixel_size) {
+        m_is_using_points = m_radius < MIN_RADIUS_PIXELS * pixel_size;
+
+        size_t vertices_per_atom = m_is_using_points ? 1 : 4;
+
+        if (m_vertices.size() < atoms.size() * vertices_per_atom)
+            m_vertices.resize(atoms.size() * vertices_per_atom);
+
+        // atoms touching the area are drawn too
+        double left = visible_area.left - m_radius;
+        double top = visible_area.top - m_radius;
+        double right = visible_area.left + visible_area.width + m_radius;
+        double bottom = visible_area.top + visible_area.height + m_radius;
+
+        size_t count = 0;
+
+        for (size_t i = 0; i < atoms.size(); ++i) {
+            double x = atoms.x[i];
+            double y = atoms.y[i];
+
+            if (!atoms.is_alive[i] || x < left || x > right || y < top || y > bottom)
+                continue;
+
+            sf::Color color = getColor(atoms.vx[i], atoms.vy[i]);
+            sf::Vertex *vertex = &m_vertices[count * vertices_per_atom];
+
+            if (m_is_using_points) {
+                vertex[0] = sf::Vertex({(float) x, (float) y}, color);
+            } else {
+                float x0 = (float) x - m_radius;
+                float y0 = (float) y - m_radius;
+                float x1 = (float) x + m_radius;
+                float y1 = (float) y + m_radius;
+
+                vertex[0] = sf::Vertex({x0, y0}, color, {0.f, 0.f});
+                vertex[1] = sf::Vertex({x1, y0}, color, {m_texture_size, 0.f});
+                vertex[2] = sf::Vertex({x1, y1}, color, {m_texture_size, m_texture_size});
+                vertex[3] = sf::Vertex({x0, y1}, color, {0.f, m_texture_size});
+            }
+
+            ++count;
+        }
+
+        m_vertices_count = count * vertices_per_atom;
+        m_atoms_count = count;
+    }
+
+    [[nodiscard]] const sf::Vertex *getVertices() const {
+        return m_vertices.data();
+    }
+
+    [[nodiscard]] size_t getVerticesCount() const {
+        return m_vertices_count;
+    }
+
+    [[nodiscard]] sf::PrimitiveType getPrimitiveType() const {
+        return m_is_using_points ? sf::Points : sf::Quads;
+    }
+
+    // points are drawn without the texture
+    [[nodiscard]] bool isUsingPoints() const {
+        return m_is_using_points;
+    }
+
+    // atoms that passed the culling in the last build
+    [[nodiscard]] size_t getAtomsCount() const {
+        return m_atoms_count;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_ATOMVERTEXBATCH_H
@@ -3,6 +3,7 @@
 
 
 #include "Atom.h"
+#include "ParticleStorage.h"
 
 class Drawer {
 public:
@@ -10,10 +11,26 @@ public:
 
     virtual void drawAtom(const Atom &atom, const sf::Vector2d &box_size) = 0;
 
+    // all alive atoms at once, drawers that can batch them override this
+    virtual void drawAtoms(const ParticleStorage &atoms, const sf::Vector2d &box_size) {
+        for (const Atom &atom: atoms) {
+            drawAtom(atom, box_size);
+        }
+    }
+
     virtual void endDraw(int iteration) = 0;
 
     [[nodiscard]] virtual bool wantsToClose() const = 0;
 
+    // called while there is nothing new to draw, so that a window stays responsive
+    virtual void pollEvents() {}
+
+    // interactive drawers only show the latest state, so frames may be dropped for them;
+    // the others, like image exports, must get every frame
+    [[nodiscard]] virtual bool isInteractive() const {
+        return false;
+    }
+
     virtual ~Drawer() = default;
 };
 
@@ -0,0 +1,216 @@
+#ifndef PHYSICSSIMULATION_FRAMEENCODER_H
+#define PHYSICSSIMULATION_FRAMEENCODER_H
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define PHYSICSSIMULATION_POPEN _popen
+#define PHYSICSSIMULATION_PCLOSE _pclose
+#else
+#define PHYSICSSIMULATION_POPEN popen
+#define PHYSICSSIMULATION_PCLOSE pclose
+#endif
+
+enum class FrameFormat {
+    JPG,
+    PNG,
+    // raw RGBA frames written in order into the standard input of a command, for example
+    // ffmpeg -f rawvideo -pix_fmt rgba -s 800x800 -r 30 -i - movie.mp4
+    RAW_VIDEO
+};
+
+struct FrameEncoderStatistics {
+    long long frames_count{0};
+    // frames that could not be written: the command did not start, the pipe was closed or saving an image failed
+    long long failed_frames_count{0};
+    // time the workers spent encoding and writing
+    double encoding_seconds{0.};
+    // time the drawer waited for a free buffer because the workers fell behind
+    double waiting_seconds{0.};
+};
+
+// Encodes and writes finished frames on worker threads, so that drawing the next frame does not wait for the disk.
+// Frame buffers are reused; at most capacity frames are queued or being encoded, then the drawer waits,
+// so no frame is ever dropped.
+class FrameEncoder {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        std::vector<sf::Uint8> pixels;
+        int iteration;
+    };
+
+    sf::Vector2u m_size;
+    std::string m_destination;
+    FrameFormat m_format;
+
+    std::FILE *m_video{nullptr};
+
+    size_t m_capacity;
+    size_t m_buffers_count{0};
+    std::vector<std::vector<sf::Uint8>> m_free_buffers;
+
+    std::deque<Frame> m_queue;
+    size_t m_encoding_count{0};
+    bool m_is_stopping{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_queue_condition;
+    std::condition_variable m_free_condition;
+
+    FrameEncoderStatistics m_statistics;
+
+    std::vector<std::thread> m_workers;
+
+    // returns whether the frame was written
+    bool encode(const Frame &frame) {
+        if (m_format == FrameFormat::RAW_VIDEO)
+            return m_video && std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), m_video) == frame.pixels.size();
+
+        sf::Image image;
+        image.create(m_size.x, m_size.y, frame.pixels.data());
+
+        return image.saveToFile(m_destination + std::to_string(frame.iteration) +
+                                (m_format == FrameFormat::PNG ? ".png" : ".jpg"));
+    }
+
+    void work() {
+        std::unique_lock lock(m_mutex);
+
+        while (true) {
+            m_queue_condition.wait(lock, [this]() { return m_is_stopping || !m_queue.empty(); });
+
+            // the queue is drained before stopping
+            if (m_queue.empty())
+                return;
+
+            Frame frame = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_encoding_count++;
+
+            lock.unlock();
+
+            auto start = Clock::now();
+            bool is_written = encode(frame);
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            lock.lock();
+
+            m_free_buffers.push_back(std::move(frame.pixels));
+            m_encoding_count--;
+
+            m_statistics.frames_count++;
+            m_statistics.failed_frames_count += !is_written;
+            m_statistics.encoding_seconds += seconds;
+
+            m_free_condition.notify_all();
+        }
+    }
+
+public:
+    // destination is the directory prefix of the images or, for RAW_VIDEO, the command receiving the frames;
+    // a video is written by one worker, so that the frames stay in order
+    FrameEncoder(const sf::Vector2u &size, std::string destination, FrameFormat format = FrameFormat::JPG,
+                 unsigned int workers_count = 2, size_t capacity = 4) :
+            m_size(size), m_destination(std::move(destination)), m_format(format),
+            m_capacity(std::max<size_t>(capacity, 1)) {
+        if (m_format == FrameFormat::RAW_VIDEO) {
+            m_video = PHYSICSSIMULATION_POPEN(m_destination.c_str(), "w");
+            workers_count = 1;
+        }
+
+        for (unsigned int i = 0; i < std::max(1u, workers_count); ++i) {
+            m_workers.emplace_back(&FrameEncoder::work, this);
+        }
+    }
+
+    FrameEncoder(const FrameEncoder &) = delete;
+
+    FrameEncoder &operator=(const FrameEncoder &) = delete;
+
+    ~FrameEncoder() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_is_stopping = true;
+        }
+
+        m_queue_condition.notify_all();
+
+        for (auto &worker: m_workers) {
+            worker.join();
+        }
+
+        if (m_video)
+            PHYSICSSIMULATION_PCLOSE(m_video);
+    }
+
+    // a buffer of width * height RGBA pixels with unspecified contents, waits while all buffers are in use
+    std::vector<sf::Uint8> acquireBuffer() {
+        std::unique_lock lock(m_mutex);
+
+        if (m_free_buffers.empty() && m_buffers_count >= m_capacity) {
+            auto start = Clock::now();
+
+            m_free_condition.wait(lock, [this]() { return !m_free_buffers.empty(); });
+
+            m_statistics.waiting_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        if (m_free_buffers.empty()) {
+            m_buffers_count++;
+
+            return std::vector<sf::Uint8>((size_t) m_size.x * m_size.y * 4);
+        }
+
+        auto buffer = std::move(m_free_buffers.back());
+        m_free_buffers.pop_back();
+
+        return buffer;
+    }
+
+    void submit(std::vector<sf::Uint8> &&pixels, int iteration) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_queue.push_back({std::move(pixels), iteration});
+        }
+
+        m_queue_condition.notify_one();
+    }
+
+    // waits until all submitted frames are written
+    void wait() {
+        std::unique_lock lock(m_mutex);
+
+        m_free_condition.wait(lock, [this]() { return m_queue.empty() && m_encoding_count == 0; });
+    }
+
+    [[nodiscard]] FrameEncoderStatistics getStatistics() {
+        std::lock_guard lock(m_mutex);
+
+        return m_statistics;
+    }
+
+    // whether the video command could not be started or a submitted frame was not written
+    [[nodiscard]] bool isFailed() {
+        std::lock_guard lock(m_mutex);
+
+        return (m_format == FrameFormat::RAW_VIDEO && !m_video) || m_statistics.failed_frames_count > 0;
+    }
+};
+
+#undef PHYSICSSIMULATION_POPEN
+#undef PHYSICSSIMULATION_PCLOSE
+
+
+#endif //PHYSICSSIMULATION_FRAMEENCODER_H
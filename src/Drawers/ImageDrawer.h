@@ -3,10 +3,58 @@
 
 #include "Atom.h"
 #include "Drawer.h"
+#include "FrameEncoder.h"
+#include "Helpers/ThreadPool.h"
 
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// RGBA pixels of a frame with the part of the sf::Image interface the shapes use
+class PixelCanvas {
+private:
+    sf::Uint8 *m_pixels;
+    sf::Vector2u m_size;
+
+public:
+    PixelCanvas(sf::Uint8 *pixels, const sf::Vector2u &size) : m_pixels(pixels), m_size(size) {}
+
+    [[nodiscard]] sf::Vector2u getSize() const {
+        return m_size;
+    }
+
+    // pixels outside the image are ignored
+    void setPixel(unsigned int x, unsigned int y, const sf::Color &color) {
+        if (x < m_size.x && y < m_size.y)
+            fillSpan(y, x, x + 1, color);
+    }
+
+    // pixels [x_begin, x_end) of the row
+    void fillSpan(unsigned int row, unsigned int x_begin, unsigned int x_end, const sf::Color &color) {
+        // whole pixels are stored at once instead of four separate bytes
+        sf::Uint8 bytes[4] = {color.r, color.g, color.b, color.a};
+        std::uint32_t value;
+        std::memcpy(&value, bytes, 4);
+
+        sf::Uint8 *pixel = m_pixels + ((size_t) row * m_size.x + x_begin) * 4;
+
+        for (unsigned int x = x_begin; x < x_end; ++x, pixel += 4) {
+            std::memcpy(pixel, &value, 4);
+        }
+    }
+
+    // rows [begin, end) in white
+    void clearRows(unsigned int begin, unsigned int end) {
+        std::memset(m_pixels + (size_t) begin * m_size.x * 4, 255, (size_t) (end - begin) * m_size.x * 4);
+    }
+};
 
 class ImageShape {
 protected:
@@ -65,7 +113,8 @@ public:
 
     [[nodiscard]] virtual bool isInside(int x, int y) const = 0;
 
-    void draw(sf::Image &image) const {
+    template<class Image>
+    void draw(Image &image) const {
         auto bb = getBoundingBox();
 
         auto bb_on_image = sf::FloatRect(
@@ -129,7 +178,10 @@ public:
     }
 
     [[nodiscard]] bool isInside(int x, int y) const override {
-        return std::pow(x - m_radius, 2) + std::pow(y - m_radius, 2) < std::pow(m_radius, 2);
+        float dx = (float) x - m_radius;
+        float dy = (float) y - m_radius;
+
+        return dx * dx + dy * dy < m_radius * m_radius;
     }
 };
 
@@ -158,41 +210,159 @@ public:
     }
 };
 
+// Draws frames into a pixel buffer and hands finished frames to a FrameEncoder, so that images are encoded
+// in the background. Atoms are drawn in parallel: the image is split into bands of rows, every band gets
+// the atoms crossing it in their order and every thread fills its bands row span by row span.
 class ImageDrawer : public Drawer {
 private:
-    sf::Image m_image;
+    struct ImageCircle {
+        float x;
+        float y;
+        sf::Color color;
+        // rows of the image the circle covers, [first_row, last_row]
+        int first_row;
+        int last_row;
+    };
+
+    static constexpr unsigned int BAND_HEIGHT = 32;
+
     sf::Vector2u m_size;
+    float m_atom_radius{5.f};
+
+    std::vector<sf::Uint8> m_pixels;
+
+    ThreadPool m_thread_pool;
+    std::vector<std::vector<ImageCircle>> m_band_circles;
+
+    FrameEncoder m_encoder;
+
+    PixelCanvas getCanvas() {
+        return {m_pixels.data(), m_size};
+    }
+
+    [[nodiscard]] unsigned int getBandsCount() const {
+        return (m_size.y + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    }
+
+    // the image is flipped vertically, like the shapes draw it
+    [[nodiscard]] sf::Vector2f getImagePosition(double x, double y, const sf::Vector2d &box_size) const {
+        return {250 + (float) (x / box_size.x * (float) m_size.x), 500 + (float) (y / box_size.y * (float) m_size.y)};
+    }
+
+    [[nodiscard]] ImageCircle getCircle(double x, double y, double vx, double vy, const sf::Vector2d &box_size) const {
+        auto position = getImagePosition(x, y, box_size);
+
+        return {
+                position.x, position.y, getColor(vx, vy),
+                std::max(0, (int) m_size.y - (int) std::floor(position.y + m_atom_radius)),
+                std::min((int) m_size.y - 1, (int) m_size.y - (int) std::ceil(position.y - m_atom_radius))
+        };
+    }
+
+    // fills the pixels of the circle in rows [row_begin, row_end], one span per row
+    void fillCircle(PixelCanvas &canvas, const ImageCircle &circle, int row_begin, int row_end) const {
+        float radius_sqr = m_atom_radius * m_atom_radius;
+
+        for (int row = row_begin; row <= row_end; ++row) {
+            float dy = (float) ((int) m_size.y - row) - circle.y;
+            float half_width_sqr = radius_sqr - dy * dy;
+
+            if (half_width_sqr <= 0)
+                continue;
+
+            float half_width = std::sqrt(half_width_sqr);
+
+            int x_begin = std::max(0, (int) std::floor(circle.x - half_width) + 1);
+            int x_end = std::min((int) m_size.x, (int) std::ceil(circle.x + half_width));
+
+            if (x_begin < x_end)
+                canvas.fillSpan(row, x_begin, x_end, circle.color);
+        }
+    }
+
+    static sf::Color getColor(double vx, double vy) {
+        return {(sf::Uint8) std::clamp(std::sqrt(vx * vx + vy * vy) * 5, 0., 255.), 0, 0};
+    }
 
 public:
-    explicit ImageDrawer(const sf::Vector2u &size) : m_size(size) {}
+    // images are saved as destination + iteration + extension, for RAW_VIDEO destination is the command
+    // receiving the frames, see FrameEncoder
+    explicit ImageDrawer(const sf::Vector2u &size, const std::string &destination = "../images/",
+                         FrameFormat format = FrameFormat::JPG,
+                         unsigned int threads_count = std::thread::hardware_concurrency(),
+                         unsigned int encoders_count = 2) :
+            m_size(size), m_thread_pool(threads_count), m_band_circles(getBandsCount()),
+            m_encoder(size, destination, format, encoders_count) {}
 
     void startDraw() override {
-        m_image.create(m_size.x, m_size.y, sf::Color::White);
-    };
+        m_pixels = m_encoder.acquireBuffer();
+
+        m_thread_pool.run([this](unsigned int thread_index) {
+            PixelCanvas canvas = getCanvas();
+
+            for (unsigned int band = thread_index; band < getBandsCount(); band += m_thread_pool.getThreadsCount()) {
+                canvas.clearRows(band * BAND_HEIGHT, std::min(m_size.y, (band + 1) * BAND_HEIGHT));
+            }
+        });
+    }
 
     void endDraw(int iteration) override {
-        m_image.saveToFile("../images/" + std::to_string(iteration) + ".jpg");
+        m_encoder.submit(std::move(m_pixels), iteration);
     }
 
     void drawAtom(const Atom &atom, const sf::Vector2d &box_size) override {
-        float radius = 5.f;
+        auto circle = getCircle(atom.position.x, atom.position.y, atom.speed.x, atom.speed.y, box_size);
 
-        auto atom_pos = sf::Vector2f(
-                250 + (float) (atom.position.x / box_size.x * (float) m_size.x),
-                500 + (float) (atom.position.y / box_size.y * (float) m_size.y)
-        );
+        PixelCanvas canvas = getCanvas();
+        fillCircle(canvas, circle, circle.first_row, circle.last_row);
+    }
 
-        Circle atom_shape;
+    void drawAtoms(const ParticleStorage &atoms, const sf::Vector2d &box_size) override {
+        for (auto &circles: m_band_circles) {
+            circles.clear();
+        }
 
-        atom_shape.setRadius(radius);
-        atom_shape.setOrigin(radius, radius);
-        atom_shape.setPosition(atom_pos);
+        for (size_t i = 0; i < atoms.size(); ++i) {
+            if (!atoms.is_alive[i])
+                continue;
 
-        atom_shape.setFillColor(
-                sf::Color((int) std::clamp(atom.getAbsoluteSpeed() * 5, 0., 255.), 0, 0)
-        );
+            auto circle = getCircle(atoms.x[i], atoms.y[i], atoms.vx[i], atoms.vy[i], box_size);
+
+            if (circle.first_row > circle.last_row)
+                continue;
+
+            for (int band = circle.first_row / (int) BAND_HEIGHT; band <= circle.last_row / (int) BAND_HEIGHT; ++band) {
+                m_band_circles[band].push_back(circle);
+            }
+        }
+
+        // bands do not share pixels, so threads never write the same memory
+        m_thread_pool.run([this](unsigned int thread_index) {
+            PixelCanvas canvas = getCanvas();
+
+            for (unsigned int band = thread_index; band < getBandsCount(); band += m_thread_pool.getThreadsCount()) {
+                int band_begin = (int) (band * BAND_HEIGHT);
+                int band_end = (int) std::min(m_size.y, (band + 1) * BAND_HEIGHT) - 1;
 
-        atom_shape.draw(m_image);
+                for (auto &circle: m_band_circles[band]) {
+                    fillCircle(canvas, circle, std::max(circle.first_row, band_begin),
+                               std::min(circle.last_row, band_end));
+                }
+            }
+        });
+    }
+
+    // waits until all finished frames are written
+    void waitForFrames() {
+        m_encoder.wait();
+    }
+
+    [[nodiscard]] FrameEncoderStatistics getEncoderStatistics() {
+        return m_encoder.getStatistics();
+    }
+
+    [[nodiscard]] bool isFailed() {
+        return m_encoder.isFailed();
     }
 
     [[nodiscard]] bool wantsToClose() const override {
@@ -206,18 +376,21 @@ public:
         moving_wall.setSize(box_size.x, 10.);
         moving_wall.setPosition(0., moving_wall_y);
 
-        moving_wall.draw(m_image);
+        PixelCanvas canvas = getCanvas();
+        moving_wall.draw(canvas);
     }
 
     void drawBorders(const sf::Vector2d &box_size) {
+        PixelCanvas canvas = getCanvas();
+
         Line({0, 0}, {0, (float) box_size.y})
-                .setFillColor(sf::Color::Black).draw(m_image);
+                .setFillColor(sf::Color::Black).draw(canvas);
         Line({0, (float) box_size.y}, {(float) box_size.x, (float) box_size.y})
-                .setFillColor(sf::Color::Black).draw(m_image);
+                .setFillColor(sf::Color::Black).draw(canvas);
         Line({(float) box_size.x, (float) box_size.y}, {(float) box_size.x, 0})
-                .setFillColor(sf::Color::Black).draw(m_image);
+                .setFillColor(sf::Color::Black).draw(canvas);
         Line({(float) box_size.x, 0}, {0, 0})
-                .setFillColor(sf::Color::Black).draw(m_image);
+                .setFillColor(sf::Color::Black).draw(canvas);
     }
 };
 
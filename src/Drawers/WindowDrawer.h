@@ -2,6 +2,7 @@
 #define PHYSICSSIMULATION_WINDOWDRAWER_H
 
 #include "Atom.h"
+#include "AtomVertexBatch.h"
 #include "Drawer.h"
 
 #include <SFML/Graphics.hpp>
@@ -20,6 +21,9 @@ private:
     std::map<sf::Event::EventType, std::function<void(const sf::Event &)>> m_callbacks;
     sf::Font m_font;
 
+    AtomVertexBatch m_atom_batch;
+    sf::Texture m_atom_texture;
+
     float m_camera_movement_speed{100.f};
 public:
     WindowDrawer(unsigned int width, unsigned int height)
@@ -33,12 +37,19 @@ public:
         m_window.setView(m_view);
 
         m_font.loadFromFile("fonts/arial.ttf");
+
+        m_atom_texture.loadFromImage(AtomVertexBatch::createAtomImage());
+        m_atom_texture.setSmooth(true);
     };
 
     [[nodiscard]] bool wantsToClose() const override {
         return !m_window.isOpen();
     }
 
+    [[nodiscard]] bool isInteractive() const override {
+        return true;
+    }
+
     void startDraw() override {
         pollEvents();
 
@@ -50,7 +61,7 @@ public:
         m_window.display();
     }
 
-    void pollEvents() {
+    void pollEvents() override {
         while (m_window.pollEvent(m_event)) {
             switch (m_event.type) {
                 case sf::Event::Closed:
@@ -101,6 +112,17 @@ public:
         m_window.draw(atom_shape);
     }
 
+    // one draw call for all atoms in the view
+    void drawAtoms(const ParticleStorage &atoms, const sf::Vector2d &box_size) override {
+        sf::Vector2f view_size = m_view.getSize();
+
+        m_atom_batch.build(atoms, {m_view.getCenter() - view_size / 2.f, view_size},
+                           view_size.x / (float) m_window.getSize().x);
+
+        m_window.draw(m_atom_batch.getVertices(), m_atom_batch.getVerticesCount(), m_atom_batch.getPrimitiveType(),
+                      m_atom_batch.isUsingPoints() ? sf::RenderStates::Default : sf::RenderStates(&m_atom_texture));
+    }
+
     void drawMovingWall(double moving_wall_y, const sf::Vector2d &box_size) {
         sf::RectangleShape moving_wall;
 
@@ -0,0 +1,124 @@
+#ifndef PHYSICSSIMULATION_BINARYSTREAM_H
+#define PHYSICSSIMULATION_BINARYSTREAM_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Values are stored as their bytes in the byte order of the machine, so a checkpoint
+// is read back bitwise equal, but only on a machine with the same byte order.
+class BinaryWriter {
+private:
+    std::vector<char> m_buffer;
+
+public:
+    template<class T>
+    void write(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<class T, class Allocator>
+    void writeVector(const std::vector<T, Allocator> &values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        write<uint64_t>(values.size());
+
+        const char *bytes = reinterpret_cast<const char *>(values.data());
+        m_buffer.insert(m_buffer.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    void writeString(const std::string &value) {
+        writeVector(std::vector<char>(value.begin(), value.end()));
+    }
+
+    [[nodiscard]] const std::vector<char> &getBuffer() const {
+        return m_buffer;
+    }
+
+    [[nodiscard]] std::vector<char> &getBuffer() {
+        return m_buffer;
+    }
+};
+
+// Reading past the end does not crash: it gives zeros and marks the reader as failed.
+class BinaryReader {
+private:
+    const char *m_data;
+    size_t m_size;
+    size_t m_position{0};
+    bool m_is_failed{false};
+
+    bool take(void *destination, size_t size) {
+        if (m_is_failed || size > m_size - m_position) {
+            m_is_failed = true;
+            return false;
+        }
+
+        // empty vectors may have no data at all
+        if (size > 0)
+            std::memcpy(destination, m_data + m_position, size);
+
+        m_position += size;
+
+        return true;
+    }
+
+public:
+    BinaryReader(const char *data, size_t size) : m_data(data), m_size(size) {}
+
+    template<class T>
+    T read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        T value{};
+
+        if (!take(&value, sizeof(T)))
+            return T{};
+
+        return value;
+    }
+
+    template<class T, class Allocator>
+    void readVector(std::vector<T, Allocator> &values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        auto size = read<uint64_t>();
+
+        if (m_is_failed || size > (m_size - m_position) / sizeof(T)) {
+            m_is_failed = true;
+            values.clear();
+            return;
+        }
+
+        values.resize(size);
+        take(values.data(), size * sizeof(T));
+    }
+
+    std::string readString() {
+        std::vector<char> bytes;
+        readVector(bytes);
+
+        return {bytes.begin(), bytes.end()};
+    }
+
+    // for data that was read fine but cannot be used
+    void setFailed() {
+        m_is_failed = true;
+    }
+
+    [[nodiscard]] bool isFailed() const {
+        return m_is_failed;
+    }
+
+    [[nodiscard]] bool isAtEnd() const {
+        return m_position == m_size;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_BINARYSTREAM_H
@@ -0,0 +1,129 @@
+#ifndef PHYSICSSIMULATION_BLOCKAVERAGE_H
+#define PHYSICSSIMULATION_BLOCKAVERAGE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "BinaryStream.h"
+
+// Running mean of a correlated time series with the error estimated by blocking (Flyvbjerg and Petersen):
+// neighbouring samples are averaged pairwise again and again, and on every level the naive error of the
+// block means is computed. Once blocks are longer than the correlation time it stops growing.
+class BlockAverage {
+private:
+    struct Level {
+        long long count{0};
+        double sum{0.};
+        double sum_sqr{0.};
+
+        double pending{0.};
+        bool has_pending{false};
+    };
+
+    std::vector<Level> m_levels;
+
+    // levels with fewer blocks give too noisy errors
+    static constexpr long long MIN_BLOCKS_COUNT = 16;
+    // one level per doubling of the count, reserved at once so that adding samples never allocates
+    static constexpr size_t MAX_LEVELS_COUNT = 64;
+
+public:
+    void add(double value) {
+        for (size_t level = 0;; ++level) {
+            if (level == m_levels.size()) {
+                if (m_levels.capacity() < MAX_LEVELS_COUNT)
+                    m_levels.reserve(MAX_LEVELS_COUNT);
+
+                m_levels.emplace_back();
+            }
+
+            auto &current = m_levels[level];
+
+            current.count++;
+            current.sum += value;
+            current.sum_sqr += value * value;
+
+            if (!current.has_pending) {
+                current.pending = value;
+                current.has_pending = true;
+
+                return;
+            }
+
+            value = (current.pending + value) / 2.;
+            current.has_pending = false;
+        }
+    }
+
+    [[nodiscard]] long long getCount() const {
+        return m_levels.empty() ? 0 : m_levels[0].count;
+    }
+
+    [[nodiscard]] double getMean() const {
+        return m_levels.empty() ? 0. : m_levels[0].sum / (double) m_levels[0].count;
+    }
+
+    [[nodiscard]] size_t getLevelsCount() const {
+        return m_levels.size();
+    }
+
+    // naive standard error of the mean computed from blocks of 2^level samples
+    [[nodiscard]] double getError(size_t level) const {
+        auto &current = m_levels[level];
+
+        if (current.count < 2)
+            return 0.;
+
+        double mean = current.sum / (double) current.count;
+        double variance = std::max(0., current.sum_sqr / (double) current.count - mean * mean);
+
+        return std::sqrt(variance / (double) (current.count - 1));
+    }
+
+    // the largest error among the levels that still have enough blocks
+    [[nodiscard]] double getError() const {
+        double error = m_levels.empty() ? 0. : getError(0);
+
+        for (size_t level = 1; level < m_levels.size() && m_levels[level].count >= MIN_BLOCKS_COUNT; ++level) {
+            error = std::max(error, getError(level));
+        }
+
+        return error;
+    }
+
+    void reset() {
+        m_levels.clear();
+    }
+
+    void writeCheckpoint(BinaryWriter &writer) const {
+        writer.write<uint64_t>(m_levels.size());
+
+        for (auto &level: m_levels) {
+            writer.write(level.count);
+            writer.write(level.sum);
+            writer.write(level.sum_sqr);
+            writer.write(level.pending);
+            writer.write(level.has_pending);
+        }
+    }
+
+    void readCheckpoint(BinaryReader &reader) {
+        m_levels.clear();
+
+        auto levels_count = reader.read<uint64_t>();
+
+        for (uint64_t i = 0; i < levels_count && !reader.isFailed(); ++i) {
+            auto &level = m_levels.emplace_back();
+
+            level.count = reader.read<long long>();
+            level.sum = reader.read<double>();
+            level.sum_sqr = reader.read<double>();
+            level.pending = reader.read<double>();
+            level.has_pending = reader.read<bool>();
+        }
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_BLOCKAVERAGE_H
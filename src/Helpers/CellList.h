@@ -0,0 +1,269 @@
+#ifndef PHYSICSSIMULATION_CELLLIST_H
+#define PHYSICSSIMULATION_CELLLIST_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "FloatBits.h"
+#include "ParticleStorage.h"
+#include "PeriodicBox.h"
+
+// Splits the plane into square cells not narrower than the interaction cutoff, so that
+// every pair closer than the cutoff lies in the same or in adjacent cells.
+// Atoms are sorted by cell with a counting sort, so rebuilding costs O(N).
+// In a periodic box the grid tiles the box exactly and cells on opposite sides are adjacent.
+class CellList {
+private:
+    // open space lets atoms fly far away from the box, so the grid size is bounded
+    static constexpr int MAX_CELLS_PER_ATOM = 4;
+
+    PeriodicBox m_box;
+
+    sf::Vector2d m_origin;
+    double m_cell_size{1.};
+    int m_cells_x{1};
+    int m_cells_y{1};
+
+    std::vector<int> m_cell_start;
+    std::vector<int> m_cell_atoms;
+    std::vector<int> m_atom_cell;
+    std::vector<int> m_cell_end;
+
+    long long m_allocations_count{0};
+
+    // resizes a buffer that lives across builds, counting every reallocation
+    void resizeBuffer(std::vector<int> &buffer, size_t size) {
+        if (size > buffer.capacity())
+            m_allocations_count++;
+
+        buffer.resize(size);
+    }
+
+    [[nodiscard]] int getCellCoordinate(double position, double origin, int cells_count) const {
+        double cell = (position - origin) / m_cell_size;
+
+        if (!FloatBits::isFinite(cell))
+            return 0;
+
+        return std::clamp((int) cell, 0, cells_count - 1);
+    }
+
+    [[nodiscard]] int getCell(double x, double y) const {
+        if (m_box.isPeriodic()) {
+            m_box.wrapPosition(x, y);
+
+            if (!FloatBits::isFinite(x) || !FloatBits::isFinite(y))
+                return 0;
+
+            return std::min((int) (x / m_box.getSize().x * m_cells_x), m_cells_x - 1) +
+                   std::min((int) (y / m_box.getSize().y * m_cells_y), m_cells_y - 1) * m_cells_x;
+        }
+
+        return getCellCoordinate(x, m_origin.x, m_cells_x) + getCellCoordinate(y, m_origin.y, m_cells_y) * m_cells_x;
+    }
+
+    // writes the distinct coordinates of the cells adjacent to the given one along one axis
+    [[nodiscard]] int getAdjacentCells(int cell, int cells_count, int *cells) const {
+        if (!m_box.isPeriodic()) {
+            int count = 0;
+
+            for (int adjacent = std::max(0, cell - 1); adjacent <= std::min(cells_count - 1, cell + 1); ++adjacent) {
+                cells[count++] = adjacent;
+            }
+
+            return count;
+        }
+
+        // with less than three cells every cell is adjacent and must be visited once
+        if (cells_count < 3) {
+            for (int adjacent = 0; adjacent < cells_count; ++adjacent) {
+                cells[adjacent] = adjacent;
+            }
+
+            return cells_count;
+        }
+
+        cells[0] = (cell + cells_count - 1) % cells_count;
+        cells[1] = cell;
+        cells[2] = (cell + 1) % cells_count;
+
+        return 3;
+    }
+
+    void buildPeriodicGrid(double cutoff) {
+        m_origin = {0, 0};
+
+        m_cells_x = std::max(1, (int) std::floor(m_box.getSize().x / cutoff));
+        m_cells_y = std::max(1, (int) std::floor(m_box.getSize().y / cutoff));
+
+        m_cell_size = std::min(m_box.getSize().x / m_cells_x, m_box.getSize().y / m_cells_y);
+    }
+
+    void buildOpenGrid(const ParticleStorage &atoms, double cutoff) {
+        // the grid covers the box and every atom that has left it
+        sf::Vector2d min_corner{0, 0};
+        sf::Vector2d max_corner = m_box.getSize();
+
+        for (int i = 0; i < atoms.size(); ++i) {
+            if (!atoms.is_alive[i] || !FloatBits::isFinite(atoms.x[i]) || !FloatBits::isFinite(atoms.y[i]))
+                continue;
+
+            min_corner.x = std::min(min_corner.x, atoms.x[i]);
+            min_corner.y = std::min(min_corner.y, atoms.y[i]);
+            max_corner.x = std::max(max_corner.x, atoms.x[i]);
+            max_corner.y = std::max(max_corner.y, atoms.y[i]);
+        }
+
+        sf::Vector2d extent = max_corner - min_corner;
+
+        double max_cells_count = (double) (MAX_CELLS_PER_ATOM * std::max<size_t>(atoms.size(), 1));
+
+        m_origin = min_corner;
+        m_cell_size = std::max(cutoff, std::sqrt(extent.x * extent.y / max_cells_count));
+        // a far away atom may stretch the grid along one axis only
+        m_cell_size = std::max(m_cell_size, std::max(extent.x, extent.y) / max_cells_count);
+
+        m_cells_x = std::max(1, (int) std::floor(extent.x / m_cell_size));
+        m_cells_y = std::max(1, (int) std::floor(extent.y / m_cell_size));
+
+        // widen the cells a bit so that the grid covers the whole extent exactly
+        m_cell_size = std::max(extent.x / m_cells_x, extent.y / m_cells_y);
+        m_cell_size = std::max(m_cell_size, cutoff);
+    }
+
+public:
+    void build(const ParticleStorage &atoms, double cutoff, const PeriodicBox &box) {
+        m_box = box;
+
+        if (box.isPeriodic())
+            buildPeriodicGrid(cutoff);
+        else
+            buildOpenGrid(atoms, cutoff);
+
+        resizeBuffer(m_cell_start, m_cells_x * m_cells_y + 1);
+        std::fill(m_cell_start.begin(), m_cell_start.end(), 0);
+        resizeBuffer(m_atom_cell, atoms.size());
+        resizeBuffer(m_cell_atoms, atoms.size());
+
+        for (int i = 0; i < atoms.size(); ++i) {
+            // dead atoms and atoms with broken coordinates are left out of the grid,
+            // so they neither feel nor exert pair forces
+            if (!atoms.is_alive[i] || !FloatBits::isFinite(atoms.x[i]) || !FloatBits::isFinite(atoms.y[i])) {
+                m_atom_cell[i] = -1;
+                continue;
+            }
+
+            int cell = getCell(atoms.x[i], atoms.y[i]);
+
+            m_atom_cell[i] = cell;
+            m_cell_start[cell + 1]++;
+        }
+
+        for (int cell = 0; cell < m_cells_x * m_cells_y; ++cell) {
+            m_cell_start[cell + 1] += m_cell_start[cell];
+        }
+
+        // atoms inside every cell stay sorted by index
+        resizeBuffer(m_cell_end, m_cells_x * m_cells_y);
+        std::copy(m_cell_start.begin(), m_cell_start.end() - 1, m_cell_end.begin());
+
+        for (int i = 0; i < atoms.size(); ++i) {
+            if (m_atom_cell[i] >= 0)
+                m_cell_atoms[m_cell_end[m_atom_cell[i]]++] = i;
+        }
+    }
+
+    // calls callback(j) for every atom j that lies in the cell of atom i or in the adjacent ones,
+    // unless is_full is set only atoms with j > i are visited; atoms outside the grid have no neighbours
+    template<class Callback>
+    void forEachNeighbour(int i, bool is_full, Callback &&callback) const {
+        int cell = m_atom_cell[i];
+
+        if (cell < 0)
+            return;
+
+        int xs[3], ys[3];
+        int xs_count = getAdjacentCells(cell % m_cells_x, m_cells_x, xs);
+        int ys_count = getAdjacentCells(cell / m_cells_x, m_cells_y, ys);
+
+        for (int y = 0; y < ys_count; ++y) {
+            for (int x = 0; x < xs_count; ++x) {
+                int neighbour_cell = xs[x] + ys[y] * m_cells_x;
+
+                for (int k = m_cell_start[neighbour_cell]; k < m_cell_start[neighbour_cell + 1]; ++k) {
+                    int j = m_cell_atoms[k];
+
+                    if (j > i || (is_full && j != i))
+                        callback(j);
+                }
+            }
+        }
+    }
+
+    // the greatest index of the atoms forEachNeighbour(i) may visit, -1 when there are none;
+    // atoms inside a cell are sorted, so it is the last atom of one of the cells
+    [[nodiscard]] int getMaxNeighbour(int i) const {
+        int cell = m_atom_cell[i];
+
+        if (cell < 0)
+            return -1;
+
+        int xs[3], ys[3];
+        int xs_count = getAdjacentCells(cell % m_cells_x, m_cells_x, xs);
+        int ys_count = getAdjacentCells(cell / m_cells_x, m_cells_y, ys);
+
+        int max_neighbour = -1;
+
+        for (int y = 0; y < ys_count; ++y) {
+            for (int x = 0; x < xs_count; ++x) {
+                int neighbour_cell = xs[x] + ys[y] * m_cells_x;
+
+                if (m_cell_start[neighbour_cell] < m_cell_start[neighbour_cell + 1])
+                    max_neighbour = std::max(max_neighbour, m_cell_atoms[m_cell_start[neighbour_cell + 1] - 1]);
+            }
+        }
+
+        return max_neighbour;
+    }
+
+    // number of times the buffers had to be reallocated, the number of cells follows the extent of the atoms
+    [[nodiscard]] long long getAllocationsCount() const {
+        return m_allocations_count;
+    }
+
+    // number of atoms in the cell of atom i and in the adjacent ones
+    [[nodiscard]] int getNeighbourhoodSize(int i) const {
+        int cell = m_atom_cell[i];
+
+        if (cell < 0)
+            return 0;
+
+        int xs[3], ys[3];
+        int xs_count = getAdjacentCells(cell % m_cells_x, m_cells_x, xs);
+        int ys_count = getAdjacentCells(cell / m_cells_x, m_cells_y, ys);
+
+        int size = 0;
+
+        for (int y = 0; y < ys_count; ++y) {
+            for (int x = 0; x < xs_count; ++x) {
+                int neighbour_cell = xs[x] + ys[y] * m_cells_x;
+
+                size += m_cell_start[neighbour_cell + 1] - m_cell_start[neighbour_cell];
+            }
+        }
+
+        return size;
+    }
+
+    [[nodiscard]] double getCellSize() const {
+        return m_cell_size;
+    }
+
+    [[nodiscard]] int getCellsCount() const {
+        return m_cells_x * m_cells_y;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_CELLLIST_H
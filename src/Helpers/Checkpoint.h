@@ -0,0 +1,171 @@
+#ifndef PHYSICSSIMULATION_CHECKPOINT_H
+#define PHYSICSSIMULATION_CHECKPOINT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "BinaryStream.h"
+
+// Checkpoint file: magic, format version, payload size, FNV-1a hash of the payload, payload.
+// The hash is checked before anything is read, so a damaged file never changes the world.
+class Checkpoint {
+private:
+    static constexpr uint32_t MAGIC = 0x50434a4c; // "LJCP"
+    static constexpr uint64_t HEADER_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+    [[nodiscard]] static uint64_t getHash(const char *data, size_t size) {
+        uint64_t hash = 14695981039346656037ull;
+
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= (unsigned char) data[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+public:
+    // increased whenever the layout of the payload changes
+    static constexpr uint32_t VERSION = 1;
+
+    // returns a writer that already holds the header, the payload is appended to it
+    [[nodiscard]] static BinaryWriter startFile() {
+        BinaryWriter writer;
+
+        writer.write(MAGIC);
+        writer.write(VERSION);
+        writer.write<uint64_t>(0);
+        writer.write<uint64_t>(0);
+
+        return writer;
+    }
+
+    // fills the size and the hash of the payload in the header
+    static void finishFile(BinaryWriter &writer) {
+        auto &buffer = writer.getBuffer();
+
+        uint64_t size = buffer.size() - HEADER_SIZE;
+        uint64_t hash = getHash(buffer.data() + HEADER_SIZE, size);
+
+        std::memcpy(buffer.data() + 2 * sizeof(uint32_t), &size, sizeof(size));
+        std::memcpy(buffer.data() + 2 * sizeof(uint32_t) + sizeof(size), &hash, sizeof(hash));
+    }
+
+    // returns a reader of the payload, failed if the file is damaged or has another version
+    [[nodiscard]] static BinaryReader openFile(const std::vector<char> &file) {
+        BinaryReader header(file.data(), file.size());
+
+        auto magic = header.read<uint32_t>();
+        auto version = header.read<uint32_t>();
+        auto size = header.read<uint64_t>();
+        auto hash = header.read<uint64_t>();
+
+        BinaryReader payload(file.data() + std::min<size_t>(HEADER_SIZE, file.size()),
+                             file.size() - std::min<size_t>(HEADER_SIZE, file.size()));
+
+        if (header.isFailed() || magic != MAGIC || version != VERSION || size != file.size() - HEADER_SIZE ||
+            hash != getHash(file.data() + HEADER_SIZE, size))
+            payload.setFailed();
+
+        return payload;
+    }
+
+    // the file is written next to the target, synced to the disk and renamed over it,
+    // so after a crash of the program or the system either the old or the new checkpoint is left
+    static bool writeFile(const std::string &path, const std::vector<char> &bytes) {
+        std::string temporary_path = path + ".tmp";
+
+        std::FILE *file = std::fopen(temporary_path.c_str(), "wb");
+
+        if (!file)
+            return false;
+
+        bool is_written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() &&
+                          std::fflush(file) == 0;
+
+#ifdef _WIN32
+        is_written = is_written && _commit(_fileno(file)) == 0;
+#else
+        is_written = is_written && fsync(fileno(file)) == 0;
+#endif
+
+        is_written = std::fclose(file) == 0 && is_written;
+
+        std::error_code error;
+
+        // unlike std::rename, replaces an existing target on Windows too
+        if (is_written)
+            std::filesystem::rename(temporary_path, path, error);
+
+        if (!is_written || error) {
+            std::filesystem::remove(temporary_path, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool readFile(const std::string &path, std::vector<char> &bytes) {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file)
+            return false;
+
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        return !file.bad();
+    }
+};
+
+// Writes checkpoints on a background thread. The state is serialized by the caller,
+// so the simulation continues while the bytes are written; at most one write is in flight.
+class AsyncCheckpointWriter {
+private:
+    std::future<bool> m_pending;
+    bool m_is_last_successful{true};
+
+public:
+    AsyncCheckpointWriter() = default;
+
+    AsyncCheckpointWriter(const AsyncCheckpointWriter &) = delete;
+
+    AsyncCheckpointWriter &operator=(const AsyncCheckpointWriter &) = delete;
+
+    ~AsyncCheckpointWriter() {
+        wait();
+    }
+
+    void write(const std::string &path, std::vector<char> bytes) {
+        wait();
+
+        m_pending = std::async(std::launch::async, [path, bytes = std::move(bytes)]() {
+            return Checkpoint::writeFile(path, bytes);
+        });
+    }
+
+    // returns whether the last finished write succeeded
+    bool wait() {
+        if (m_pending.valid())
+            m_is_last_successful = m_pending.get();
+
+        return m_is_last_successful;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_CHECKPOINT_H
@@ -0,0 +1,21 @@
+#ifndef PHYSICSSIMULATION_FLOATBITS_H
+#define PHYSICSSIMULATION_FLOATBITS_H
+
+#include <bit>
+#include <cstdint>
+
+// Checks of nan and infinity made on the bits of the value. The project is built with -Ofast, which implies
+// -ffinite-math-only: the compiler may fold std::isfinite to true and treat comparisons as never unordered,
+// so neither of them catches broken values.
+class FloatBits {
+public:
+    [[nodiscard]] inline static bool isFinite(double value) {
+        // nan and infinity are the values with all exponent bits set
+        const uint64_t exponent_mask = 0x7ff0000000000000;
+
+        return (std::bit_cast<uint64_t>(value) & exponent_mask) != exponent_mask;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_FLOATBITS_H
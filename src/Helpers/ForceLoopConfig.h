@@ -0,0 +1,41 @@
+#ifndef PHYSICSSIMULATION_FORCELOOPCONFIG_H
+#define PHYSICSSIMULATION_FORCELOOPCONFIG_H
+
+#include "WorldData.h"
+
+// Settings that change what the force loop computes, as compile time constants,
+// so that every combination gets its own loop without branches on the settings.
+template<bool IsCollidingWithWalls, bool IsGravityEnabled, bool IsPeriodic>
+struct ForceLoopConfig {
+    static constexpr bool IS_COLLIDING_WITH_WALLS = IsCollidingWithWalls;
+    static constexpr bool IS_GRAVITY_ENABLED = IsGravityEnabled;
+    static constexpr bool IS_PERIODIC = IsPeriodic;
+};
+
+class ForceLoopDispatcher {
+private:
+    // turns the runtime flags into template arguments one by one
+    template<bool... Flags, class Callback, class... Rest>
+    static void dispatchFlags(Callback &&callback, bool flag, Rest... rest) {
+        if (flag)
+            dispatchFlags<Flags..., true>(callback, rest...);
+        else
+            dispatchFlags<Flags..., false>(callback, rest...);
+    }
+
+    template<bool... Flags, class Callback>
+    static void dispatchFlags(Callback &&callback) {
+        callback(ForceLoopConfig<Flags...>());
+    }
+
+public:
+    // calls callback(config) with the config matching the current settings, once per force evaluation
+    template<class Callback>
+    static void dispatch(const WorldData &world_data, Callback &&callback) {
+        dispatchFlags<>(callback, world_data.isCollidingWithWalls(), world_data.isGravityEnabled(),
+                        world_data.isPeriodic());
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_FORCELOOPCONFIG_H
@@ -0,0 +1,45 @@
+#ifndef PHYSICSSIMULATION_FORCEOBSERVABLES_H
+#define PHYSICSSIMULATION_FORCEOBSERVABLES_H
+
+// Quantities that are collected as a by-product of a force evaluation.
+struct ForceObservables {
+    // pair, wall and gravity potential energy
+    double potential_energy{0.};
+
+    // virial tensor: sums of r_ij,a * f_ij,b over interacting pairs
+    double virial_xx{0.};
+    double virial_yy{0.};
+    double virial_xy{0.};
+
+    // adds a pair with separation (dx, dy) and force divided by distance
+    void addPairVirial(double dx, double dy, double force) {
+        virial_xx += force * dx * dx;
+        virial_yy += force * dy * dy;
+        virial_xy += force * dx * dy;
+    }
+
+    [[nodiscard]] double getVirial() const {
+        return virial_xx + virial_yy;
+    }
+
+    ForceObservables &operator+=(const ForceObservables &other) {
+        potential_energy += other.potential_energy;
+        virial_xx += other.virial_xx;
+        virial_yy += other.virial_yy;
+        virial_xy += other.virial_xy;
+
+        return *this;
+    }
+
+    ForceObservables &operator*=(double factor) {
+        potential_energy *= factor;
+        virial_xx *= factor;
+        virial_yy *= factor;
+        virial_xy *= factor;
+
+        return *this;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_FORCEOBSERVABLES_H
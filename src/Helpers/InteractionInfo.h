@@ -2,14 +2,25 @@
 #define PHYSICSSIMULATION_INTERACTIONINFO_H
 
 #include <cmath>
+#include <memory>
+
+#include "PairPotentialTable.h"
 
 struct InteractionInfo {
     InteractionInfo() = default;
 
-    InteractionInfo(double sigma, double epsilon) :
+    InteractionInfo(double sigma, double epsilon) : InteractionInfo(sigma, epsilon, nullptr) {};
+
+    // sigma and epsilon still describe the wall, the pair cutoff is taken from the table
+    InteractionInfo(double sigma, double epsilon, std::shared_ptr<const PairPotentialTable> potential) :
             SIGMA(sigma), EPSILON(epsilon),
             SIGMA_SIXTH_POWER(std::pow(sigma, 6)), SIGMA_SQR(sigma * sigma),
-            COEFF(-24. * epsilon * std::pow(sigma, 6)) {};
+            COEFF(-24. * epsilon * std::pow(sigma, 6)),
+            CUTOFF(potential ? potential->getCutoff() : 2.5 * sigma), CUTOFF_SQR(CUTOFF * CUTOFF),
+            POTENTIAL_SHIFT(4. * epsilon * (std::pow(2.5, -12) - std::pow(2.5, -6))),
+            WALL_COEFF(63. * M_PI * epsilon * std::pow(sigma, 12) / 256.), WALL_CUTOFF(2.5 * sigma),
+            WALL_POTENTIAL_SHIFT(WALL_COEFF / 10. / std::pow(WALL_CUTOFF, 10)),
+            WALL_FORCE_SHIFT(WALL_COEFF / std::pow(WALL_CUTOFF, 11)), POTENTIAL(std::move(potential)) {};
 
     const double SIGMA {0.};
     const double EPSILON {0.};
@@ -18,6 +29,23 @@ struct InteractionInfo {
     const double SIGMA_SQR {0.};
 
     const double COEFF {0.};
+
+    const double CUTOFF {0.};
+    const double CUTOFF_SQR {0.};
+
+    // value of the potential at the cutoff, subtracted to make the truncated potential continuous
+    const double POTENTIAL_SHIFT {0.};
+
+    // wall force is WALL_COEFF / d^11, at the cutoff it is about 1e-4 of epsilon / sigma
+    const double WALL_COEFF {0.};
+    const double WALL_CUTOFF {0.};
+    // values of the wall potential and force at the cutoff, both are subtracted so that atoms
+    // crossing the cutoff see neither a jump of energy nor a jump of force
+    const double WALL_POTENTIAL_SHIFT {0.};
+    const double WALL_FORCE_SHIFT {0.};
+
+    // tabulated pair potential, the built-in Lennard-Jones is used when it is not set
+    const std::shared_ptr<const PairPotentialTable> POTENTIAL;
 };
 
 #endif //PHYSICSSIMULATION_INTERACTIONINFO_H
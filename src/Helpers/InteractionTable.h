@@ -0,0 +1,71 @@
+#ifndef PHYSICSSIMULATION_INTERACTIONTABLE_H
+#define PHYSICSSIMULATION_INTERACTIONTABLE_H
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "Atom.h"
+#include "InteractionInfo.h"
+
+// Dense species x species matrix of interactions, so that the force loop finds parameters of a pair
+// by plain indexing. It is rebuilt from the registered interactions whenever they change.
+// Pairs without registered interaction get zero parameters and do not interact at all.
+class InteractionTable {
+private:
+    size_t m_species_count{0};
+    std::vector<InteractionInfo> m_table;
+
+    double m_max_cutoff{0.};
+    bool m_has_tabulated_potentials{false};
+
+public:
+    void build(const std::map<std::pair<AtomType, AtomType>, InteractionInfo> &interactions, size_t species_count) {
+        std::vector<InteractionInfo> table;
+        table.reserve(species_count * species_count);
+
+        m_max_cutoff = 0;
+        m_has_tabulated_potentials = false;
+
+        for (size_t first = 0; first < species_count; ++first) {
+            for (size_t second = 0; second < species_count; ++second) {
+                // interactions are symmetric, so a pair may be registered in any order
+                auto it = interactions.find({AtomType(first), AtomType(second)});
+
+                if (it == interactions.end())
+                    it = interactions.find({AtomType(second), AtomType(first)});
+
+                table.push_back(it == interactions.end() ? InteractionInfo() : it->second);
+
+                // walls are not atoms, so they do not affect the size of the cells
+                if (AtomType(first) != AtomType::WALL && AtomType(second) != AtomType::WALL)
+                    m_max_cutoff = std::max(m_max_cutoff, table.back().CUTOFF);
+
+                if (table.back().POTENTIAL)
+                    m_has_tabulated_potentials = true;
+            }
+        }
+
+        m_species_count = species_count;
+        m_table = std::move(table);
+    }
+
+    [[nodiscard]] const InteractionInfo &get(AtomType first, AtomType second) const {
+        return m_table[(size_t) first * m_species_count + (size_t) second];
+    }
+
+    [[nodiscard]] size_t getSpeciesCount() const {
+        return m_species_count;
+    }
+
+    [[nodiscard]] double getMaxCutoff() const {
+        return m_max_cutoff;
+    }
+
+    [[nodiscard]] bool hasTabulatedPotentials() const {
+        return m_has_tabulated_potentials;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_INTERACTIONTABLE_H
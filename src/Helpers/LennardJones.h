@@ -8,19 +8,49 @@
 class LennardJones {
 public:
     [[nodiscard]] inline static double getForce(double distance_sqr, const InteractionInfo &info) {
-        if (distance_sqr >= 6.25 * info.SIGMA_SQR) return 0;
+        if (distance_sqr >= info.CUTOFF_SQR) return 0;
 
         return info.COEFF * (std::pow(distance_sqr, 3) - 2 * info.SIGMA_SIXTH_POWER)
                / std::pow(distance_sqr, 7);
     }
 
+    // force of a flat wall made of atoms integrated over the wall, without the shift
+    [[nodiscard]] inline static double getUnshiftedWallForce(double distance, const InteractionInfo &info) {
+        double inverse = 1. / distance;
+        double inverse_sqr = inverse * inverse;
+        double inverse_eighth = inverse_sqr * inverse_sqr * inverse_sqr * inverse_sqr;
+
+        return info.WALL_COEFF * inverse_eighth * inverse_sqr * inverse;
+    }
+
+    // shifted to go to zero at the wall cutoff, so it is continuous there
     [[nodiscard]] inline static double getWallForce(double distance, const InteractionInfo &info) {
-        return 63 * M_PI * info.EPSILON * std::pow(info.SIGMA_SIXTH_POWER, 2) / 256 / std::pow(distance, 11);
+        if (distance >= info.WALL_CUTOFF) return 0;
+
+        return getUnshiftedWallForce(distance, info) - info.WALL_FORCE_SHIFT;
+    }
+
+    // potential of the atom at the given distance from the wall, getWallForce is minus its derivative;
+    // it and its derivative are continuous at the wall cutoff
+    [[nodiscard]] inline static double getWallPotential(double distance, const InteractionInfo &info) {
+        if (distance >= info.WALL_CUTOFF) return 0;
+
+        return getUnshiftedWallForce(distance, info) * distance / 10 - info.WALL_POTENTIAL_SHIFT +
+               (distance - info.WALL_CUTOFF) * info.WALL_FORCE_SHIFT;
     }
 
     [[nodiscard]] inline static double getPotential(double distance, const InteractionInfo &info) {
         return 4 * info.EPSILON * (std::pow(info.SIGMA / distance, 12) - std::pow(info.SIGMA / distance, 6));
     }
+
+    // potential consistent with getForce: zero beyond the cutoff and shifted to be continuous there
+    [[nodiscard]] inline static double getShiftedPotential(double distance_sqr, const InteractionInfo &info) {
+        if (distance_sqr >= info.CUTOFF_SQR) return 0;
+
+        double inverse_sixth = info.SIGMA_SIXTH_POWER / (distance_sqr * distance_sqr * distance_sqr);
+
+        return 4 * info.EPSILON * (inverse_sixth * inverse_sixth - inverse_sixth) - info.POTENTIAL_SHIFT;
+    }
 };
 
 
@@ -0,0 +1,216 @@
+#ifndef PHYSICSSIMULATION_LENNARDJONESKERNEL_H
+#define PHYSICSSIMULATION_LENNARDJONESKERNEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "AlignedAllocator.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PHYSICSSIMULATION_X86_SIMD
+
+#include <immintrin.h>
+#endif
+
+enum class SimdLevel {
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+// Pairs of atoms gathered into contiguous arrays, so that the kernel can process several pairs at once.
+struct PairBatch {
+    std::vector<int> atoms;
+    std::vector<int> neighbours;
+
+    AlignedVector<double> dx;
+    AlignedVector<double> dy;
+    AlignedVector<double> distance_sqr;
+
+    AlignedVector<double> sigma_sixth_power;
+    AlignedVector<double> coeff;
+    AlignedVector<double> cutoff_sqr;
+
+    // force divided by distance, zero for pairs beyond the cutoff
+    AlignedVector<double> force;
+
+    size_t size{0};
+
+    // number of times the arrays had to be reallocated
+    long long allocations_count{0};
+
+    // while all pairs share one interaction its parameters are not copied into the arrays
+    bool is_uniform{true};
+    double uniform_sigma_sixth_power{0.};
+    double uniform_coeff{0.};
+    double uniform_cutoff_sqr{0.};
+
+    void clear() {
+        size = 0;
+        is_uniform = true;
+    }
+
+    void setUniformParameters(double sigma_sixth_power_value, double coeff_value, double cutoff_sqr_value) {
+        uniform_sigma_sixth_power = sigma_sixth_power_value;
+        uniform_coeff = coeff_value;
+        uniform_cutoff_sqr = cutoff_sqr_value;
+    }
+
+    // copies the uniform parameters into the arrays, so that pairs with other interactions can be added
+    void makeNonUniform() {
+        std::fill(sigma_sixth_power.begin(), sigma_sixth_power.begin() + size, uniform_sigma_sixth_power);
+        std::fill(coeff.begin(), coeff.begin() + size, uniform_coeff);
+        std::fill(cutoff_sqr.begin(), cutoff_sqr.begin() + size, uniform_cutoff_sqr);
+
+        is_uniform = false;
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity <= neighbours.size())
+            return;
+
+        if (capacity > neighbours.capacity())
+            allocations_count++;
+
+        atoms.resize(capacity);
+        neighbours.resize(capacity);
+        dx.resize(capacity);
+        dy.resize(capacity);
+        distance_sqr.resize(capacity);
+        sigma_sixth_power.resize(capacity);
+        coeff.resize(capacity);
+        cutoff_sqr.resize(capacity);
+        force.resize(capacity);
+    }
+};
+
+// Lennard-Jones force without pow and branches: f / r = COEFF / r^8 * (1 - 2 sigma^6 / r^6).
+// Pairs beyond the cutoff are masked out instead of skipped, so several pairs are handled per instruction.
+class LennardJonesKernel {
+private:
+    static void computeScalar(PairBatch &batch, size_t begin) {
+        for (size_t k = begin; k < batch.size; ++k) {
+            double sigma_sixth_power = batch.is_uniform ? batch.uniform_sigma_sixth_power : batch.sigma_sixth_power[k];
+            double coeff = batch.is_uniform ? batch.uniform_coeff : batch.coeff[k];
+            double cutoff_sqr = batch.is_uniform ? batch.uniform_cutoff_sqr : batch.cutoff_sqr[k];
+
+            double inverse_sqr = 1. / batch.distance_sqr[k];
+            double inverse_sixth = inverse_sqr * inverse_sqr * inverse_sqr;
+
+            double force = coeff * inverse_sixth * inverse_sqr * (1. - 2. * sigma_sixth_power * inverse_sixth);
+
+            batch.force[k] = batch.distance_sqr[k] < cutoff_sqr ? force : 0.;
+        }
+    }
+
+#ifdef PHYSICSSIMULATION_X86_SIMD
+
+    __attribute__((target("avx2")))
+    static void computeAvx2(PairBatch &batch) {
+        const __m256d one = _mm256_set1_pd(1.);
+        const __m256d two = _mm256_set1_pd(2.);
+
+        __m256d sigma_sixth_power = _mm256_set1_pd(batch.uniform_sigma_sixth_power);
+        __m256d coeff = _mm256_set1_pd(batch.uniform_coeff);
+        __m256d cutoff_sqr = _mm256_set1_pd(batch.uniform_cutoff_sqr);
+
+        size_t k = 0;
+
+        for (; k + 4 <= batch.size; k += 4) {
+            __m256d distance_sqr = _mm256_load_pd(&batch.distance_sqr[k]);
+
+            if (!batch.is_uniform) {
+                sigma_sixth_power = _mm256_load_pd(&batch.sigma_sixth_power[k]);
+                coeff = _mm256_load_pd(&batch.coeff[k]);
+                cutoff_sqr = _mm256_load_pd(&batch.cutoff_sqr[k]);
+            }
+
+            __m256d inverse_sqr = _mm256_div_pd(one, distance_sqr);
+            __m256d inverse_sixth = _mm256_mul_pd(_mm256_mul_pd(inverse_sqr, inverse_sqr), inverse_sqr);
+
+            __m256d repulsion = _mm256_mul_pd(_mm256_mul_pd(two, sigma_sixth_power), inverse_sixth);
+            __m256d force = _mm256_mul_pd(
+                    _mm256_mul_pd(coeff, _mm256_mul_pd(inverse_sixth, inverse_sqr)),
+                    _mm256_sub_pd(one, repulsion)
+            );
+
+            __m256d mask = _mm256_cmp_pd(distance_sqr, cutoff_sqr, _CMP_LT_OQ);
+
+            _mm256_store_pd(&batch.force[k], _mm256_and_pd(force, mask));
+        }
+
+        computeScalar(batch, k);
+    }
+
+    __attribute__((target("avx512f")))
+    static void computeAvx512(PairBatch &batch) {
+        const __m512d one = _mm512_set1_pd(1.);
+        const __m512d two = _mm512_set1_pd(2.);
+
+        __m512d sigma_sixth_power = _mm512_set1_pd(batch.uniform_sigma_sixth_power);
+        __m512d coeff = _mm512_set1_pd(batch.uniform_coeff);
+        __m512d cutoff_sqr = _mm512_set1_pd(batch.uniform_cutoff_sqr);
+
+        size_t k = 0;
+
+        for (; k + 8 <= batch.size; k += 8) {
+            __m512d distance_sqr = _mm512_load_pd(&batch.distance_sqr[k]);
+
+            if (!batch.is_uniform) {
+                sigma_sixth_power = _mm512_load_pd(&batch.sigma_sixth_power[k]);
+                coeff = _mm512_load_pd(&batch.coeff[k]);
+                cutoff_sqr = _mm512_load_pd(&batch.cutoff_sqr[k]);
+            }
+
+            __m512d inverse_sqr = _mm512_div_pd(one, distance_sqr);
+            __m512d inverse_sixth = _mm512_mul_pd(_mm512_mul_pd(inverse_sqr, inverse_sqr), inverse_sqr);
+
+            __m512d repulsion = _mm512_mul_pd(_mm512_mul_pd(two, sigma_sixth_power), inverse_sixth);
+            __m512d force = _mm512_mul_pd(
+                    _mm512_mul_pd(coeff, _mm512_mul_pd(inverse_sixth, inverse_sqr)),
+                    _mm512_sub_pd(one, repulsion)
+            );
+
+            __mmask8 mask = _mm512_cmp_pd_mask(distance_sqr, cutoff_sqr, _CMP_LT_OQ);
+
+            _mm512_store_pd(&batch.force[k], _mm512_maskz_mov_pd(mask, force));
+        }
+
+        computeScalar(batch, k);
+    }
+
+#endif
+
+public:
+    [[nodiscard]] static SimdLevel getBestSimdLevel() {
+#ifdef PHYSICSSIMULATION_X86_SIMD
+        static const SimdLevel level = __builtin_cpu_supports("avx512f") ? SimdLevel::AVX512
+                                       : __builtin_cpu_supports("avx2") ? SimdLevel::AVX2
+                                       : SimdLevel::SCALAR;
+
+        return level;
+#else
+        return SimdLevel::SCALAR;
+#endif
+    }
+
+    static void compute(PairBatch &batch, SimdLevel level = getBestSimdLevel()) {
+        switch (level) {
+#ifdef PHYSICSSIMULATION_X86_SIMD
+            case SimdLevel::AVX512:
+                computeAvx512(batch);
+                break;
+            case SimdLevel::AVX2:
+                computeAvx2(batch);
+                break;
+#endif
+            default:
+                computeScalar(batch, 0);
+                break;
+        }
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_LENNARDJONESKERNEL_H
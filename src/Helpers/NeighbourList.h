@@ -0,0 +1,235 @@
+#ifndef PHYSICSSIMULATION_NEIGHBOURLIST_H
+#define PHYSICSSIMULATION_NEIGHBOURLIST_H
+
+#include <algorithm>
+#include <vector>
+
+#include "BinaryStream.h"
+#include "FloatBits.h"
+#include "ParticleStorage.h"
+#include "CellList.h"
+#include "PeriodicBox.h"
+
+enum class NeighbourListRebuildPolicy {
+    // rebuild when some atom has moved further than half of the skin since the last build
+    AUTOMATIC,
+    // rebuild on every force evaluation, useful to check the automatic policy
+    ALWAYS
+};
+
+struct NeighbourListStatistics {
+    long long rebuilds_count{0};
+    long long evaluations_count{0};
+    long long pairs_count{0};
+
+    [[nodiscard]] double getAverageEvaluationsPerRebuild() const {
+        return rebuilds_count == 0 ? 0. : (double) evaluations_count / (double) rebuilds_count;
+    }
+};
+
+// Verlet list: for every atom stores the atoms that were closer than cutoff + skin at the moment
+// of the last build. While no atom has moved further than skin / 2 the list contains every pair
+// closer than cutoff, so it can be reused across many force evaluations.
+// A half list keeps only neighbours with greater index, a full one keeps all of them.
+class NeighbourList {
+private:
+    std::vector<int> m_offsets;
+    std::vector<int> m_neighbours;
+    std::vector<double> m_reference_x;
+    std::vector<double> m_reference_y;
+    bool m_is_full{false};
+    bool m_is_valid{false};
+
+    NeighbourListStatistics m_statistics;
+
+    long long m_allocations_count{0};
+
+    // resizes a buffer that lives across builds, counting every reallocation
+    template<class T>
+    void resizeBuffer(std::vector<T> &buffer, size_t size) {
+        if (size > buffer.capacity())
+            m_allocations_count++;
+
+        buffer.resize(size);
+    }
+
+public:
+    // displacements are measured to the nearest image, so wrapping atoms around a periodic box does not force a rebuild
+    [[nodiscard]] bool needsRebuild(const ParticleStorage &atoms, double skin,
+                                    NeighbourListRebuildPolicy policy, const PeriodicBox &box) const {
+        if (!m_is_valid || policy == NeighbourListRebuildPolicy::ALWAYS || atoms.size() != m_reference_x.size())
+            return true;
+
+        double max_displacement_sqr = skin * skin / 4.;
+
+        for (int i = 0; i < atoms.size(); ++i) {
+            double dx = atoms.x[i] - m_reference_x[i];
+            double dy = atoms.y[i] - m_reference_y[i];
+
+            box.applyMinimumImage(dx, dy);
+
+            // atoms with non finite coordinates must not keep a stale list
+            if (!FloatBits::isFinite(dx) || !FloatBits::isFinite(dy) || dx * dx + dy * dy > max_displacement_sqr)
+                return true;
+        }
+
+        return false;
+    }
+
+    void build(const ParticleStorage &atoms, const CellList &cell_list, double radius, bool is_full,
+               const PeriodicBox &box) {
+        double radius_sqr = radius * radius;
+
+        m_is_full = is_full;
+
+        resizeBuffer(m_offsets, atoms.size() + 1);
+        m_neighbours.clear();
+        resizeBuffer(m_reference_x, atoms.size());
+        resizeBuffer(m_reference_y, atoms.size());
+        std::copy(atoms.x.begin(), atoms.x.end(), m_reference_x.begin());
+        std::copy(atoms.y.begin(), atoms.y.end(), m_reference_y.begin());
+
+        for (int i = 0; i < atoms.size(); ++i) {
+            m_offsets[i] = (int) m_neighbours.size();
+
+            // dead atoms are not in the cell list and have no neighbours
+            if (!atoms.is_alive[i])
+                continue;
+
+            cell_list.forEachNeighbour(i, is_full, [&](int j) {
+                double dx = atoms.x[i] - atoms.x[j];
+                double dy = atoms.y[i] - atoms.y[j];
+
+                box.applyMinimumImage(dx, dy);
+
+                if (dx * dx + dy * dy < radius_sqr) {
+                    if (m_neighbours.size() == m_neighbours.capacity())
+                        m_allocations_count++;
+
+                    m_neighbours.push_back(j);
+                }
+            });
+        }
+
+        m_offsets[atoms.size()] = (int) m_neighbours.size();
+
+        m_is_valid = true;
+        m_statistics.rebuilds_count++;
+    }
+
+    // the greatest index among the neighbours of atom i, -1 when it has none
+    [[nodiscard]] int getMaxNeighbour(int i) const {
+        int max_neighbour = -1;
+
+        for (int k = m_offsets[i]; k < m_offsets[i + 1]; ++k) {
+            max_neighbour = std::max(max_neighbour, m_neighbours[k]);
+        }
+
+        return max_neighbour;
+    }
+
+    // number of times the buffers had to be reallocated, the number of pairs follows the density
+    [[nodiscard]] long long getAllocationsCount() const {
+        return m_allocations_count;
+    }
+
+    // forces a rebuild on the next evaluation, e.g. after some atoms were removed
+    void invalidate() {
+        m_is_valid = false;
+    }
+
+    // renumbers atoms after ParticleStorage::compact, so the list survives the compaction;
+    // the order of atoms is kept, so a half list stays a half list
+    void remap(const std::vector<int> &new_indices) {
+        if (!m_is_valid || new_indices.size() != m_reference_x.size()) {
+            m_is_valid = false;
+            return;
+        }
+
+        int count = 0;
+        int kept = 0;
+
+        for (int i = 0; i < new_indices.size(); ++i) {
+            int begin = m_offsets[i];
+            int end = m_offsets[i + 1];
+
+            if (new_indices[i] < 0)
+                continue;
+
+            m_offsets[kept] = count;
+            m_reference_x[kept] = m_reference_x[i];
+            m_reference_y[kept] = m_reference_y[i];
+
+            for (int k = begin; k < end; ++k) {
+                int j = new_indices[m_neighbours[k]];
+
+                if (j >= 0)
+                    m_neighbours[count++] = j;
+            }
+
+            kept++;
+        }
+
+        m_offsets[kept] = count;
+
+        m_offsets.resize(kept + 1);
+        m_neighbours.resize(count);
+        m_reference_x.resize(kept);
+        m_reference_y.resize(kept);
+    }
+
+    // must be called once per force evaluation that uses the list
+    void registerEvaluation() {
+        m_statistics.evaluations_count++;
+        m_statistics.pairs_count += (long long) m_neighbours.size();
+    }
+
+    template<class Callback>
+    void forEachNeighbour(int i, Callback &&callback) const {
+        for (int k = m_offsets[i]; k < m_offsets[i + 1]; ++k) {
+            callback(m_neighbours[k]);
+        }
+    }
+
+    [[nodiscard]] int getNeighboursCount(int i) const {
+        return m_offsets[i + 1] - m_offsets[i];
+    }
+
+    [[nodiscard]] bool isFull() const {
+        return m_is_full;
+    }
+
+    [[nodiscard]] const NeighbourListStatistics &getStatistics() const {
+        return m_statistics;
+    }
+
+    void resetStatistics() {
+        m_statistics = NeighbourListStatistics();
+    }
+
+    // the order of neighbours decides the order of summation, so a restarted run needs the same list
+    void writeCheckpoint(BinaryWriter &writer) const {
+        writer.write(m_is_full);
+        writer.write(m_is_valid);
+        writer.write(m_statistics);
+
+        writer.writeVector(m_offsets);
+        writer.writeVector(m_neighbours);
+        writer.writeVector(m_reference_x);
+        writer.writeVector(m_reference_y);
+    }
+
+    void readCheckpoint(BinaryReader &reader) {
+        m_is_full = reader.read<bool>();
+        m_is_valid = reader.read<bool>();
+        m_statistics = reader.read<NeighbourListStatistics>();
+
+        reader.readVector(m_offsets);
+        reader.readVector(m_neighbours);
+        reader.readVector(m_reference_x);
+        reader.readVector(m_reference_y);
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_NEIGHBOURLIST_H
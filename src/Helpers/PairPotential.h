@@ -0,0 +1,28 @@
+#ifndef PHYSICSSIMULATION_PAIRPOTENTIAL_H
+#define PHYSICSSIMULATION_PAIRPOTENTIAL_H
+
+#include "InteractionInfo.h"
+#include "LennardJones.h"
+
+// Pair force and potential of an interaction: tabulated when the interaction has a table,
+// the built-in Lennard-Jones otherwise.
+class PairPotential {
+public:
+    // force divided by distance
+    [[nodiscard]] inline static double getForce(double distance_sqr, const InteractionInfo &info) {
+        if (info.POTENTIAL)
+            return info.POTENTIAL->getForce(distance_sqr);
+
+        return LennardJones::getForce(distance_sqr, info);
+    }
+
+    [[nodiscard]] inline static double getShiftedPotential(double distance_sqr, const InteractionInfo &info) {
+        if (info.POTENTIAL)
+            return info.POTENTIAL->getPotential(distance_sqr);
+
+        return LennardJones::getShiftedPotential(distance_sqr, info);
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_PAIRPOTENTIAL_H
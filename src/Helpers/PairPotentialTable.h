@@ -0,0 +1,170 @@
+#ifndef PHYSICSSIMULATION_PAIRPOTENTIALTABLE_H
+#define PHYSICSSIMULATION_PAIRPOTENTIALTABLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// energy and force (minus derivative of the energy by distance) of a pair at some distance
+struct PairPotentialValue {
+    double energy{0.};
+    double force{0.};
+};
+
+// Any pair potential tabulated in r^2, so that the force loop never takes square roots or powers.
+// Between the knots the energy is a cubic Hermite spline in r^2 matching the energy and its derivative,
+// the force is taken from the derivative of the same spline, so energy and force stay consistent.
+// The potential is shifted to vanish at the cutoff; closer than the smallest tabulated distance
+// the potential is evaluated directly.
+class PairPotentialTable {
+public:
+    using Potential = std::function<PairPotentialValue(double)>;
+
+private:
+    Potential m_potential;
+
+    double m_cutoff;
+    double m_cutoff_sqr;
+    double m_min_distance_sqr;
+
+    double m_step;
+    double m_inverse_step;
+
+    double m_energy_shift;
+
+    // coefficients of the cubic a + b t + c t^2 + d t^3 for every interval, t is in [0, 1]
+    std::vector<double> m_coefficients;
+
+    // energy derivative by r^2
+    [[nodiscard]] static double getDerivative(PairPotentialValue value, double distance_sqr) {
+        return -value.force / (2. * std::sqrt(distance_sqr));
+    }
+
+public:
+    PairPotentialTable(Potential potential, double min_distance, double cutoff, int intervals_count = 2048) :
+            m_potential(std::move(potential)), m_cutoff(cutoff), m_cutoff_sqr(cutoff * cutoff),
+            m_min_distance_sqr(min_distance * min_distance),
+            m_step((m_cutoff_sqr - m_min_distance_sqr) / intervals_count), m_inverse_step(1. / m_step),
+            m_energy_shift(m_potential(cutoff).energy) {
+        m_coefficients.resize(4 * intervals_count);
+
+        double previous_distance_sqr = m_min_distance_sqr;
+        PairPotentialValue previous = m_potential(min_distance);
+
+        for (int k = 0; k < intervals_count; ++k) {
+            double distance_sqr = m_min_distance_sqr + (k + 1) * m_step;
+            PairPotentialValue current = m_potential(std::sqrt(distance_sqr));
+
+            double u0 = previous.energy - m_energy_shift;
+            double u1 = current.energy - m_energy_shift;
+            double d0 = m_step * getDerivative(previous, previous_distance_sqr);
+            double d1 = m_step * getDerivative(current, distance_sqr);
+
+            m_coefficients[4 * k] = u0;
+            m_coefficients[4 * k + 1] = d0;
+            m_coefficients[4 * k + 2] = 3. * (u1 - u0) - 2. * d0 - d1;
+            m_coefficients[4 * k + 3] = 2. * (u0 - u1) + d0 + d1;
+
+            previous_distance_sqr = distance_sqr;
+            previous = current;
+        }
+    }
+
+    // force divided by distance, like LennardJones::getForce
+    [[nodiscard]] double getForce(double distance_sqr) const {
+        if (distance_sqr >= m_cutoff_sqr) return 0;
+
+        if (distance_sqr < m_min_distance_sqr) {
+            return m_potential(std::sqrt(distance_sqr)).force / std::sqrt(distance_sqr);
+        }
+
+        double position = (distance_sqr - m_min_distance_sqr) * m_inverse_step;
+        int k = std::min((int) position, (int) m_coefficients.size() / 4 - 1);
+        double t = position - k;
+
+        const double *c = &m_coefficients[4 * k];
+
+        return -2. * m_inverse_step * (c[1] + t * (2. * c[2] + 3. * t * c[3]));
+    }
+
+    [[nodiscard]] double getPotential(double distance_sqr) const {
+        if (distance_sqr >= m_cutoff_sqr) return 0;
+
+        if (distance_sqr < m_min_distance_sqr) {
+            return m_potential(std::sqrt(distance_sqr)).energy - m_energy_shift;
+        }
+
+        double position = (distance_sqr - m_min_distance_sqr) * m_inverse_step;
+        int k = std::min((int) position, (int) m_coefficients.size() / 4 - 1);
+        double t = position - k;
+
+        const double *c = &m_coefficients[4 * k];
+
+        return c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+    }
+
+    [[nodiscard]] double getCutoff() const {
+        return m_cutoff;
+    }
+
+    // 12-6 Lennard-Jones truncated at the cutoff, the same potential as the built-in one
+    static std::shared_ptr<const PairPotentialTable>
+    createLennardJones(double sigma, double epsilon, double cutoff_factor = 2.5) {
+        return std::make_shared<const PairPotentialTable>(getLennardJones(sigma, epsilon), 0.5 * sigma,
+                                                          cutoff_factor * sigma);
+    }
+
+    // Lennard-Jones with the force shifted to vanish at the cutoff too
+    static std::shared_ptr<const PairPotentialTable>
+    createShiftedForceLennardJones(double sigma, double epsilon, double cutoff_factor = 2.5) {
+        double cutoff = cutoff_factor * sigma;
+        Potential lennard_jones = getLennardJones(sigma, epsilon);
+        PairPotentialValue at_cutoff = lennard_jones(cutoff);
+
+        return std::make_shared<const PairPotentialTable>(
+                [lennard_jones, at_cutoff, cutoff](double distance) {
+                    PairPotentialValue value = lennard_jones(distance);
+
+                    return PairPotentialValue{
+                            value.energy + (distance - cutoff) * at_cutoff.force,
+                            value.force - at_cutoff.force
+                    };
+                }, 0.5 * sigma, cutoff);
+    }
+
+    // Weeks-Chandler-Andersen: purely repulsive Lennard-Jones cut at its minimum
+    static std::shared_ptr<const PairPotentialTable> createWeeksChandlerAndersen(double sigma, double epsilon) {
+        return std::make_shared<const PairPotentialTable>(getLennardJones(sigma, epsilon), 0.5 * sigma,
+                                                          std::pow(2., 1. / 6.) * sigma);
+    }
+
+    // Morse potential D (e^(-2a(r - r0)) - 2 e^(-a(r - r0))) with the well of depth D at r0
+    static std::shared_ptr<const PairPotentialTable>
+    createMorse(double depth, double width, double equilibrium_distance, double cutoff) {
+        return std::make_shared<const PairPotentialTable>(
+                [depth, width, equilibrium_distance](double distance) {
+                    double exponent = std::exp(-width * (distance - equilibrium_distance));
+
+                    return PairPotentialValue{
+                            depth * (exponent * exponent - 2. * exponent),
+                            2. * width * depth * (exponent * exponent - exponent)
+                    };
+                }, 0.25 * equilibrium_distance, cutoff);
+    }
+
+    static Potential getLennardJones(double sigma, double epsilon) {
+        return [sigma, epsilon](double distance) {
+            double inverse_sixth = std::pow(sigma / distance, 6);
+
+            return PairPotentialValue{
+                    4. * epsilon * (inverse_sixth * inverse_sixth - inverse_sixth),
+                    24. * epsilon * (2. * inverse_sixth * inverse_sixth - inverse_sixth) / distance
+            };
+        };
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_PAIRPOTENTIALTABLE_H
@@ -0,0 +1,72 @@
+#ifndef PHYSICSSIMULATION_PERIODICBOX_H
+#define PHYSICSSIMULATION_PERIODICBOX_H
+
+#include <cmath>
+
+#include "Atom.h"
+
+// Box with optional periodic boundaries. In the periodic case the distance between two atoms is
+// taken to the nearest image (minimum image convention), which is correct while the cutoff
+// is smaller than half of the box.
+class PeriodicBox {
+private:
+    sf::Vector2d m_size;
+    bool m_is_periodic{false};
+
+    [[nodiscard]] static double getMinimumImage(double delta, double size) {
+        // atoms are wrapped after every step, so one shift is almost always enough
+        if (delta > size / 2.)
+            delta -= size;
+        else if (delta < -size / 2.)
+            delta += size;
+
+        if (std::abs(delta) > size / 2.)
+            delta -= size * std::round(delta / size);
+
+        return delta;
+    }
+
+    [[nodiscard]] static double wrap(double position, double size) {
+        if (position >= 0 && position < size)
+            return position;
+
+        position -= size * std::floor(position / size);
+
+        // rounding may give exactly size for tiny negative positions
+        return position < size ? position : 0.;
+    }
+
+public:
+    PeriodicBox() = default;
+
+    PeriodicBox(const sf::Vector2d &size, bool is_periodic) : m_size(size), m_is_periodic(is_periodic) {}
+
+    [[nodiscard]] const sf::Vector2d &getSize() const {
+        return m_size;
+    }
+
+    [[nodiscard]] bool isPeriodic() const {
+        return m_is_periodic;
+    }
+
+    // turns the difference of two positions into the difference to the nearest image
+    void applyMinimumImage(double &dx, double &dy) const {
+        if (!m_is_periodic)
+            return;
+
+        dx = getMinimumImage(dx, m_size.x);
+        dy = getMinimumImage(dy, m_size.y);
+    }
+
+    // moves the position into [0, size)
+    void wrapPosition(double &x, double &y) const {
+        if (!m_is_periodic)
+            return;
+
+        x = wrap(x, m_size.x);
+        y = wrap(y, m_size.y);
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_PERIODICBOX_H
@@ -59,6 +59,10 @@ EXAMPLE USAGE
 #include <limits>
 // For:
 //   std::numeric_limits
+#include <sstream>
+#include <string>
+// For:
+//   std::ostringstream, std::istringstream
 
 // Version number
 // Guaranteed to increase with with each release.
@@ -130,6 +134,30 @@ public:
         _rng.seed(rng_type::result_type(s));
     }
 
+    // getState / setState
+    // Text form of the generator state, so that a restarted simulation continues
+    //  the same sequence. setState returns false for malformed state.
+    std::string getState() const {
+        std::ostringstream stream;
+        stream << _seed_needed << ' ' << _rng;
+
+        return stream.str();
+    }
+
+    bool setState(const std::string &state) {
+        std::istringstream stream(state);
+        bool seed_needed;
+        rng_type rng;
+
+        if (!(stream >> seed_needed >> rng))
+            return false;
+
+        _seed_needed = seed_needed;
+        _rng = rng;
+
+        return true;
+    }
+
     // i
     // Return uniformly distributed random integer in range [0, n-1], or
     //  0 if n <= 0. Range is {0, 1} if no parameter given.
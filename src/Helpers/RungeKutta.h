@@ -2,11 +2,30 @@
 #define PHYSICSSIMULATION_RUNGEKUTTA_H
 
 #include <functional>
+#include <span>
+#include <vector>
 
 template<class T>
 class RungeKutta {
 protected:
-    std::vector<T> k1, k2, k3, k4;
+    // one arena holds all four stages, it is reallocated only when the state grows
+    std::vector<T> m_arena;
+    std::span<T> k1, k2, k3, k4;
+
+    long long m_allocations_count{0};
+
+    void prepareStages(size_t size) {
+        if (4 * size > m_arena.capacity())
+            m_allocations_count++;
+
+        m_arena.resize(4 * size);
+
+        k1 = std::span<T>(m_arena.data(), size);
+        k2 = std::span<T>(m_arena.data() + size, size);
+        k3 = std::span<T>(m_arena.data() + 2 * size, size);
+        k4 = std::span<T>(m_arena.data() + 3 * size, size);
+    }
+
 public:
     static double integrate(double xn, double yn, const std::function<double(double, double)> &function, double h) {
         auto k1 = function(xn, yn);
@@ -17,45 +36,32 @@ public:
         return yn + h / 6. * (k1 + 2 * k2 + 2 * k3 + k4);
     }
 
-    void integrate(
-            std::vector<T> &yn,
-            const std::function<void(const std::vector<T> &, std::vector<T> &)> &function,
-            double h
-    ) {
-        k1.clear();
-        k1.resize(yn.size());
+    // function(y, derivative) must overwrite every element of derivative
+    template<class Function>
+    void integrate(std::span<T> yn, Function &&function, double h) {
+        prepareStages(yn.size());
 
-        k2.clear();
-        k2.resize(yn.size());
-
-        k3.clear();
-        k3.resize(yn.size());
-
-        k4.clear();
-        k4.resize(yn.size());
-
-
-        function(yn, k1);
+        function(std::span<const T>(yn), k1);
 
         for (int i = 0; i < yn.size(); i++) {
             yn[i] += h / 2. * k1[i];
         }
 
-        function(yn, k2);
+        function(std::span<const T>(yn), k2);
 
         for (int i = 0; i < yn.size(); i++) {
             yn[i] -= h / 2. * k1[i];
             yn[i] += h / 2. * k2[i];
         }
 
-        function(yn, k3);
+        function(std::span<const T>(yn), k3);
 
         for (int i = 0; i < yn.size(); i++) {
             yn[i] -= h / 2. * k2[i];
             yn[i] += h * k3[i];
         }
 
-        function(yn, k4);
+        function(std::span<const T>(yn), k4);
 
         for (int i = 0; i < yn.size(); i++) {
             yn[i] -= h * k3[i];
@@ -63,6 +69,11 @@ public:
             yn[i] += h / 6. * (k1[i] + 2. * k2[i] + 2. * k3[i] + k4[i]);
         }
     }
+
+    // number of times the stage arena had to be reallocated
+    [[nodiscard]] long long getAllocationsCount() const {
+        return m_allocations_count;
+    }
 };
 
 
@@ -0,0 +1,167 @@
+#ifndef PHYSICSSIMULATION_SNAPSHOTBUFFER_H
+#define PHYSICSSIMULATION_SNAPSHOTBUFFER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+// what the producer does when the consumer has not taken the previous snapshot yet
+enum class FrameDropPolicy {
+    // waits for the consumer, nothing is lost but the producer is as slow as the consumer
+    WAIT,
+    // replaces the waiting snapshot, the consumer always gets the latest one
+    DROP_OLDEST,
+    // keeps the waiting snapshot and skips the new one
+    DROP_NEWEST
+};
+
+struct SnapshotBufferStatistics {
+    long long published_count{0};
+    long long dropped_count{0};
+    // time the producer waited for the consumer
+    double waiting_seconds{0.};
+};
+
+// Triple buffer between one producer and one consumer: the producer fills one slot, one finished slot waits
+// for the consumer and the consumer reads the third, so neither of them ever sees a slot being changed.
+// Slots are reused, only their indices move between the roles.
+template<class T>
+class SnapshotBuffer {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    T m_slots[3];
+
+    int m_writing{0};
+    int m_ready{1};
+    int m_reading{2};
+    bool m_is_ready{false};
+    bool m_is_closed{false};
+
+    FrameDropPolicy m_policy;
+    SnapshotBufferStatistics m_statistics;
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready_condition;
+    std::condition_variable m_taken_condition;
+
+    // the caller holds the lock and the consumer has a slot to take
+    const T &take() {
+        std::swap(m_reading, m_ready);
+        m_is_ready = false;
+
+        m_taken_condition.notify_one();
+
+        return m_slots[m_reading];
+    }
+
+public:
+    explicit SnapshotBuffer(FrameDropPolicy policy) : m_policy(policy) {}
+
+    // Whether the producer should fill a new snapshot now. With WAIT it waits until the previous one is taken,
+    // with DROP_NEWEST it returns false while the previous one is waiting, so the copy is not even made.
+    bool isAcceptingSnapshot() {
+        std::unique_lock lock(m_mutex);
+
+        if (m_policy == FrameDropPolicy::WAIT && m_is_ready) {
+            auto start = Clock::now();
+
+            m_taken_condition.wait(lock, [this]() { return !m_is_ready || m_is_closed; });
+
+            m_statistics.waiting_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        // nobody takes snapshots any more
+        if (m_is_closed)
+            return false;
+
+        if (m_policy == FrameDropPolicy::DROP_NEWEST && m_is_ready) {
+            m_statistics.dropped_count++;
+            return false;
+        }
+
+        return true;
+    }
+
+    // the slot only the producer touches until publish()
+    T &getWritingSlot() {
+        return m_slots[m_writing];
+    }
+
+    void publish() {
+        {
+            std::lock_guard lock(m_mutex);
+
+            if (m_is_ready)
+                m_statistics.dropped_count++;
+
+            std::swap(m_writing, m_ready);
+            m_is_ready = true;
+
+            m_statistics.published_count++;
+        }
+
+        m_ready_condition.notify_one();
+    }
+
+    // no snapshots come after this, the consumer still gets the waiting one
+    void close() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_is_closed = true;
+        }
+
+        m_ready_condition.notify_all();
+        m_taken_condition.notify_all();
+    }
+
+    // Waits for the next snapshot and returns it, nullptr once the buffer is closed and empty.
+    // The snapshot stays valid until the next call.
+    const T *acquire() {
+        std::unique_lock lock(m_mutex);
+
+        m_ready_condition.wait(lock, [this]() { return m_is_ready || m_is_closed; });
+
+        return m_is_ready ? &take() : nullptr;
+    }
+
+    // like acquire(), but gives up after the timeout and returns nullptr
+    template<class Rep, class Period>
+    const T *acquireFor(std::chrono::duration<Rep, Period> timeout) {
+        std::unique_lock lock(m_mutex);
+
+        m_ready_condition.wait_for(lock, timeout, [this]() { return m_is_ready || m_is_closed; });
+
+        return m_is_ready ? &take() : nullptr;
+    }
+
+    void setPolicy(FrameDropPolicy policy) {
+        std::lock_guard lock(m_mutex);
+
+        m_policy = policy;
+    }
+
+    // makes a closed buffer usable again, a snapshot left in it is dropped
+    void reopen() {
+        std::lock_guard lock(m_mutex);
+
+        m_is_ready = false;
+        m_is_closed = false;
+    }
+
+    [[nodiscard]] bool isFinished() {
+        std::lock_guard lock(m_mutex);
+
+        return m_is_closed && !m_is_ready;
+    }
+
+    [[nodiscard]] SnapshotBufferStatistics getStatistics() {
+        std::lock_guard lock(m_mutex);
+
+        return m_statistics;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_SNAPSHOTBUFFER_H
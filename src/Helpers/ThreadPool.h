@@ -0,0 +1,155 @@
+#ifndef PHYSICSSIMULATION_THREADPOOL_H
+#define PHYSICSSIMULATION_THREADPOOL_H
+
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+struct ThreadPoolStatistics {
+    // wall-clock time spent inside run()
+    double total_seconds{0.};
+    // time every thread spent executing tasks, the rest of total_seconds it was waiting
+    std::vector<double> busy_seconds;
+
+    [[nodiscard]] double getIdleSeconds(unsigned int thread_index) const {
+        return total_seconds - busy_seconds[thread_index];
+    }
+
+    // ratio of the busiest thread time to the average one, 1 means perfect balance
+    [[nodiscard]] double getImbalance() const {
+        double total_busy_seconds = 0;
+        double max_busy_seconds = 0;
+
+        for (double seconds: busy_seconds) {
+            total_busy_seconds += seconds;
+            max_busy_seconds = std::max(max_busy_seconds, seconds);
+        }
+
+        return total_busy_seconds == 0 ? 1. : max_busy_seconds * (double) busy_seconds.size() / total_busy_seconds;
+    }
+};
+
+// Keeps worker threads alive between force evaluations. Each call to run() is one phase:
+// all threads pass the start barrier, execute the task with their own index and meet
+// at the end barrier. The calling thread works as the thread with index 0.
+class ThreadPool {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // padded so that threads do not share cache lines while updating their counters
+    struct alignas(64) ThreadTime {
+        double busy_seconds{0.};
+    };
+
+    unsigned int m_threads_count;
+
+    std::vector<ThreadTime> m_thread_times;
+    double m_total_seconds{0.};
+
+    std::vector<std::thread> m_threads;
+
+    std::barrier<> m_start_barrier;
+    std::barrier<> m_end_barrier;
+
+    // the task is referenced without type erasure into std::function, so running it never allocates
+    const void *m_task{nullptr};
+    void (*m_task_invoker)(const void *, unsigned int){nullptr};
+    bool m_is_stopping{false};
+
+    void execute(unsigned int thread_index) {
+        auto start = Clock::now();
+
+        m_task_invoker(m_task, thread_index);
+
+        m_thread_times[thread_index].busy_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    void work(unsigned int thread_index) {
+        while (true) {
+            m_start_barrier.arrive_and_wait();
+
+            if (m_is_stopping)
+                return;
+
+            execute(thread_index);
+
+            m_end_barrier.arrive_and_wait();
+        }
+    }
+
+public:
+    explicit ThreadPool(unsigned int threads_count) :
+            m_threads_count(std::max(1u, threads_count)),
+            m_thread_times(m_threads_count),
+            m_start_barrier(m_threads_count),
+            m_end_barrier(m_threads_count) {
+        m_threads.reserve(m_threads_count - 1);
+
+        for (unsigned int i = 1; i < m_threads_count; ++i) {
+            m_threads.emplace_back(&ThreadPool::work, this, i);
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        m_is_stopping = true;
+        m_start_barrier.arrive_and_wait();
+
+        for (auto &thread: m_threads) {
+            thread.join();
+        }
+    }
+
+    // calls task(thread_index) on every thread and returns when all of them are done
+    template<class Task>
+    void run(const Task &task) {
+        auto start = Clock::now();
+
+        m_task = &task;
+        m_task_invoker = [](const void *task_pointer, unsigned int thread_index) {
+            (*static_cast<const Task *>(task_pointer))(thread_index);
+        };
+
+        m_start_barrier.arrive_and_wait();
+
+        execute(0);
+
+        m_end_barrier.arrive_and_wait();
+
+        m_task = nullptr;
+
+        m_total_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    [[nodiscard]] ThreadPoolStatistics getStatistics() const {
+        ThreadPoolStatistics statistics;
+
+        statistics.total_seconds = m_total_seconds;
+
+        for (auto &thread_time: m_thread_times) {
+            statistics.busy_seconds.push_back(thread_time.busy_seconds);
+        }
+
+        return statistics;
+    }
+
+    void resetStatistics() {
+        m_total_seconds = 0;
+
+        for (auto &thread_time: m_thread_times) {
+            thread_time.busy_seconds = 0;
+        }
+    }
+
+    [[nodiscard]] unsigned int getThreadsCount() const {
+        return m_threads_count;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_THREADPOOL_H
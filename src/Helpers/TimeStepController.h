@@ -0,0 +1,81 @@
+#ifndef PHYSICSSIMULATION_TIMESTEPCONTROLLER_H
+#define PHYSICSSIMULATION_TIMESTEPCONTROLLER_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "FloatBits.h"
+
+struct TimeDeltaRecord {
+    int iteration;
+    double time;
+    double dt;
+};
+
+// Chooses the time step so that no atom moves further than the given distance during one step:
+// v * dt + a * dt^2 / 2 <= max displacement, where v and a are the largest speed and acceleration.
+// The step shrinks immediately during close approaches, but grows only gradually in calm phases.
+class TimeStepController {
+private:
+    double m_max_displacement{0.25};
+    double m_min_time_delta{1e-6};
+    double m_max_time_delta{0.1};
+    double m_max_growth{1.05};
+
+public:
+    [[nodiscard]] double getTimeDelta(double previous_dt, double max_speed, double max_acceleration) const {
+        // a broken atom makes every estimate meaningless, the smallest step is the safest
+        if (!FloatBits::isFinite(max_speed) || !FloatBits::isFinite(max_acceleration))
+            return m_min_time_delta;
+
+        double dt = m_max_time_delta;
+
+        if (max_acceleration > 0) {
+            dt = (std::sqrt(max_speed * max_speed + 2. * max_acceleration * m_max_displacement) - max_speed) /
+                 max_acceleration;
+        } else if (max_speed > 0) {
+            dt = m_max_displacement / max_speed;
+        }
+
+        // huge finite values may still overflow into nan, which must not slip through the clamp
+        if (!FloatBits::isFinite(dt) || dt <= 0)
+            return m_min_time_delta;
+
+        return std::clamp(std::min(dt, previous_dt * m_max_growth), m_min_time_delta, m_max_time_delta);
+    }
+
+    [[nodiscard]] double getMaxDisplacement() const {
+        return m_max_displacement;
+    }
+
+    [[nodiscard]] double getMinTimeDelta() const {
+        return m_min_time_delta;
+    }
+
+    [[nodiscard]] double getMaxTimeDelta() const {
+        return m_max_time_delta;
+    }
+
+    [[nodiscard]] double getMaxGrowth() const {
+        return m_max_growth;
+    }
+
+    void setMaxDisplacement(double maxDisplacement) {
+        m_max_displacement = maxDisplacement;
+    }
+
+    void setMinTimeDelta(double minTimeDelta) {
+        m_min_time_delta = minTimeDelta;
+    }
+
+    void setMaxTimeDelta(double maxTimeDelta) {
+        m_max_time_delta = maxTimeDelta;
+    }
+
+    void setMaxGrowth(double maxGrowth) {
+        m_max_growth = maxGrowth;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_TIMESTEPCONTROLLER_H
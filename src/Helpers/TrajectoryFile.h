@@ -0,0 +1,618 @@
+#ifndef PHYSICSSIMULATION_TRAJECTORYFILE_H
+#define PHYSICSSIMULATION_TRAJECTORYFILE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "Atom.h"
+#include "BinaryStream.h"
+#include "FloatBits.h"
+#include "ParticleStorage.h"
+
+// one stored frame, only alive atoms; vx and vy are empty when velocities are not stored
+struct TrajectoryFrame {
+    int iteration{0};
+    double time{0.};
+    sf::Vector2d box_size;
+
+    std::vector<int> id;
+    std::vector<AtomType> type;
+
+    std::vector<double> x;
+    std::vector<double> y;
+
+    bool has_velocities{false};
+    std::vector<double> vx;
+    std::vector<double> vy;
+
+    [[nodiscard]] size_t size() const {
+        return id.size();
+    }
+};
+
+// where a frame lies in the file, known without reading its payload
+struct TrajectoryFrameInfo {
+    uint64_t offset{0};
+    uint64_t size{0};
+
+    int iteration{0};
+    double time{0.};
+};
+
+// Trajectory file: magic and format version, then frames one after another. Every frame is a chunk
+// with a header holding its size, iteration and time, so the frame index is built by jumping
+// from header to header and any frame is read without touching the others.
+// Coordinates and velocities are quantized with a fixed step and packed with as many bits
+// as the spread of the column needs; ids are delta coded, types are run length coded.
+class TrajectoryFile {
+private:
+    // variable length integers: 7 bits per byte, the high bit marks that more bytes follow
+    static void writeVarint(std::vector<uint8_t> &bytes, uint64_t value) {
+        while (value >= 0x80) {
+            bytes.push_back((uint8_t) (value | 0x80));
+            value >>= 7;
+        }
+
+        bytes.push_back((uint8_t) value);
+    }
+
+    static uint64_t readVarint(const std::vector<uint8_t> &bytes, size_t &position, bool &is_failed) {
+        uint64_t value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position >= bytes.size())
+                break;
+
+            uint8_t byte = bytes[position++];
+            value |= (uint64_t) (byte & 0x7f) << shift;
+
+            if (!(byte & 0x80))
+                return value;
+        }
+
+        is_failed = true;
+        return 0;
+    }
+
+    enum class ColumnMode : uint8_t {
+        RAW,
+        PACKED
+    };
+
+    // columns with quantized values beyond this are stored raw, so that their spread fits into 63 bits
+    static constexpr double MAX_QUANTIZED = 2e18;
+
+public:
+    static constexpr uint32_t MAGIC = 0x52544a4c; // "LJTR"
+    static constexpr uint32_t FRAME_MAGIC = 0x4d415246; // "FRAM"
+
+    // increased whenever the layout of the frames changes
+    static constexpr uint32_t VERSION = 1;
+
+    struct FrameHeader {
+        uint32_t magic;
+        int32_t iteration;
+        uint64_t size;
+        double time;
+    };
+
+    static constexpr uint64_t FILE_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+    // the values of the indices, rounded to the step; a step of zero keeps them exact
+    template<class Values>
+    static void writeColumn(BinaryWriter &writer, const Values &values, const std::vector<int> &indices,
+                            double step, std::vector<uint64_t> &words) {
+        double inverse_step = step > 0 ? 1. / step : 0.;
+        double min = 0, max = 0;
+        bool is_packable = step > 0;
+
+        for (size_t k = 0; k < indices.size() && is_packable; ++k) {
+            double scaled = values[indices[k]] * inverse_step;
+
+            is_packable = FloatBits::isFinite(scaled) && std::abs(scaled) < MAX_QUANTIZED;
+
+            min = k == 0 ? scaled : std::min(min, scaled);
+            max = k == 0 ? scaled : std::max(max, scaled);
+        }
+
+        // laid out like BinaryWriter::writeVector
+        if (!is_packable) {
+            writer.write(ColumnMode::RAW);
+            writer.write<uint64_t>(indices.size());
+
+            auto &buffer = writer.getBuffer();
+            size_t position = buffer.size();
+            buffer.resize(position + indices.size() * sizeof(double));
+
+            for (int i: indices) {
+                std::memcpy(buffer.data() + position, &values[i], sizeof(double));
+                position += sizeof(double);
+            }
+
+            return;
+        }
+
+        // rounding half away from zero with a plain cast is much cheaper than std::llround
+        auto quantize = [](double scaled) {
+            return (int64_t) (scaled + (scaled >= 0 ? 0.5 : -0.5));
+        };
+
+        int64_t offset = quantize(min);
+        auto range = (uint64_t) (quantize(max) - offset);
+        int bits = range == 0 ? 0 : 64 - __builtin_clzll(range);
+
+        words.assign((indices.size() * bits + 63) / 64, 0);
+
+        uint64_t accumulator = 0;
+        int filled = 0;
+        size_t word = 0;
+
+        for (size_t k = 0; k < indices.size() && bits > 0; ++k) {
+            auto value = (uint64_t) (quantize(values[indices[k]] * inverse_step) - offset);
+
+            accumulator |= value << filled;
+            filled += bits;
+
+            if (filled >= 64) {
+                words[word++] = accumulator;
+                filled -= 64;
+                accumulator = filled > 0 ? value >> (bits - filled) : 0;
+            }
+        }
+
+        if (filled > 0)
+            words[word] = accumulator;
+
+        writer.write(ColumnMode::PACKED);
+        writer.write(step);
+        writer.write(offset);
+        writer.write<uint8_t>(bits);
+        writer.writeVector(words);
+    }
+
+    static void readColumn(BinaryReader &reader, std::vector<double> &values, size_t count,
+                           std::vector<uint64_t> &words) {
+        auto mode = reader.read<ColumnMode>();
+
+        if (mode == ColumnMode::RAW) {
+            reader.readVector(values);
+
+            if (values.size() != count)
+                reader.setFailed();
+
+            return;
+        }
+
+        auto step = reader.read<double>();
+        auto offset = reader.read<int64_t>();
+        auto bits = reader.read<uint8_t>();
+        reader.readVector(words);
+
+        if (mode != ColumnMode::PACKED || bits > 63 || words.size() != (count * bits + 63) / 64) {
+            reader.setFailed();
+            return;
+        }
+
+        values.resize(count);
+
+        uint64_t mask = bits == 0 ? 0 : (~0ull >> (64 - bits));
+        size_t position = 0;
+
+        for (size_t k = 0; k < count; ++k) {
+            size_t word = position / 64;
+            int shift = (int) (position % 64);
+
+            uint64_t value = bits == 0 ? 0 : words[word] >> shift;
+
+            if (shift + bits > 64)
+                value |= words[word + 1] << (64 - shift);
+
+            values[k] = (double) (offset + (int64_t) (value & mask)) * step;
+            position += bits;
+        }
+    }
+
+    // ids mostly grow by one, so deltas take a byte per atom
+    static void writeIds(BinaryWriter &writer, const AlignedVector<int> &ids, const std::vector<int> &indices,
+                         std::vector<uint8_t> &bytes) {
+        bytes.clear();
+
+        int64_t previous = -1;
+
+        for (int i: indices) {
+            int64_t delta = ids[i] - previous;
+
+            // zigzag: small negative deltas stay small
+            writeVarint(bytes, (uint64_t) ((delta << 1) ^ (delta >> 63)));
+            previous = ids[i];
+        }
+
+        writer.writeVector(bytes);
+    }
+
+    static void readIds(BinaryReader &reader, std::vector<int> &ids, size_t count, std::vector<uint8_t> &bytes) {
+        reader.readVector(bytes);
+
+        ids.resize(count);
+
+        size_t position = 0;
+        bool is_failed = false;
+        int64_t previous = -1;
+
+        for (size_t k = 0; k < count && !is_failed; ++k) {
+            uint64_t zigzag = readVarint(bytes, position, is_failed);
+
+            previous += (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+            ids[k] = (int) previous;
+        }
+
+        if (is_failed || position != bytes.size())
+            reader.setFailed();
+    }
+
+    // pairs of a type and the length of its run
+    static void writeTypes(BinaryWriter &writer, const AlignedVector<AtomType> &types,
+                           const std::vector<int> &indices, std::vector<uint8_t> &bytes) {
+        bytes.clear();
+
+        for (size_t k = 0; k < indices.size();) {
+            AtomType type = types[indices[k]];
+            size_t length = 1;
+
+            while (k + length < indices.size() && types[indices[k + length]] == type) {
+                ++length;
+            }
+
+            bytes.push_back((uint8_t) type);
+            writeVarint(bytes, length);
+
+            k += length;
+        }
+
+        writer.writeVector(bytes);
+    }
+
+    static void readTypes(BinaryReader &reader, std::vector<AtomType> &types, size_t count,
+                          std::vector<uint8_t> &bytes) {
+        reader.readVector(bytes);
+
+        types.clear();
+        types.reserve(count);
+
+        size_t position = 0;
+        bool is_failed = false;
+
+        while (position < bytes.size() && !is_failed) {
+            auto type = (AtomType) bytes[position++];
+            uint64_t length = readVarint(bytes, position, is_failed);
+
+            if (length > count - types.size()) {
+                is_failed = true;
+                break;
+            }
+
+            types.insert(types.end(), length, type);
+        }
+
+        if (is_failed || types.size() != count)
+            reader.setFailed();
+    }
+
+    // Appends to frames the complete frames from the offset on and returns where they end.
+    // A frame cut short by a crash is not listed.
+    static uint64_t scanFrames(std::ifstream &file, uint64_t offset, std::vector<TrajectoryFrameInfo> &frames) {
+        file.clear();
+        file.seekg(0, std::ios::end);
+        auto file_size = (uint64_t) file.tellg();
+
+        while (offset + sizeof(FrameHeader) <= file_size) {
+            FrameHeader header{};
+
+            file.seekg((std::streamoff) offset);
+            file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+            if (!file || header.magic != FRAME_MAGIC || header.size > file_size - offset - sizeof(header))
+                break;
+
+            frames.push_back({offset, header.size, header.iteration, header.time});
+            offset += sizeof(header) + header.size;
+        }
+
+        file.clear();
+
+        return offset;
+    }
+
+    static bool hasValidHeader(std::ifstream &file) {
+        uint32_t header[2]{};
+
+        file.clear();
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(header), sizeof(header));
+
+        return file && header[0] == MAGIC && header[1] == VERSION;
+    }
+};
+
+// Writes frames at the end of a trajectory file; an existing file is continued.
+// A frame is encoded right away and written on a background thread while the simulation goes on,
+// at most one write is in flight. A frame with an iteration not after the last stored one
+// (a run resumed from a checkpoint) first drops the stored frames from that iteration on.
+class TrajectoryWriter {
+private:
+    std::filesystem::path m_path;
+    std::ofstream m_file;
+    bool m_is_failed{false};
+
+    std::vector<TrajectoryFrameInfo> m_frames;
+    uint64_t m_end{0};
+
+    double m_position_step;
+    double m_velocity_step;
+    bool m_is_writing_velocities;
+
+    // one frame is encoded while the other is being written
+    BinaryWriter m_encoded;
+    BinaryWriter m_writing;
+    std::future<bool> m_pending;
+
+    std::vector<int> m_indices;
+    std::vector<uint64_t> m_words;
+    std::vector<uint8_t> m_bytes;
+
+    void open() {
+        std::error_code error;
+
+        if (!std::filesystem::exists(m_path, error) || std::filesystem::file_size(m_path, error) == 0) {
+            std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+
+            file.write(reinterpret_cast<const char *>(&TrajectoryFile::MAGIC), sizeof(uint32_t));
+            file.write(reinterpret_cast<const char *>(&TrajectoryFile::VERSION), sizeof(uint32_t));
+
+            m_is_failed = !file;
+            m_end = TrajectoryFile::FILE_HEADER_SIZE;
+        } else {
+            std::ifstream file(m_path, std::ios::binary);
+
+            // a file of another kind or version is never overwritten
+            if (!TrajectoryFile::hasValidHeader(file)) {
+                m_is_failed = true;
+                return;
+            }
+
+            m_end = TrajectoryFile::scanFrames(file, TrajectoryFile::FILE_HEADER_SIZE, m_frames);
+        }
+
+        if (!m_is_failed)
+            truncate(m_end);
+    }
+
+    // drops everything after the offset, such as a frame cut short by a crash
+    void truncate(uint64_t end) {
+        m_file.close();
+
+        std::error_code error;
+
+        if (std::filesystem::file_size(m_path, error) != end)
+            std::filesystem::resize_file(m_path, end, error);
+
+        m_file.open(m_path, std::ios::binary | std::ios::app);
+        m_is_failed = error || !m_file;
+        m_end = end;
+    }
+
+    void encode(const ParticleStorage &atoms, int iteration, double time, sf::Vector2d box_size) {
+        m_indices.clear();
+
+        for (size_t i = 0; i < atoms.size(); ++i) {
+            if (atoms.is_alive[i])
+                m_indices.push_back((int) i);
+        }
+
+        auto &buffer = m_encoded.getBuffer();
+        buffer.clear();
+
+        m_encoded.write(TrajectoryFile::FrameHeader{TrajectoryFile::FRAME_MAGIC, iteration, 0, time});
+
+        m_encoded.write(box_size);
+        m_encoded.write<uint64_t>(m_indices.size());
+        m_encoded.write<uint8_t>(m_is_writing_velocities);
+
+        TrajectoryFile::writeIds(m_encoded, atoms.id, m_indices, m_bytes);
+        TrajectoryFile::writeTypes(m_encoded, atoms.type, m_indices, m_bytes);
+
+        TrajectoryFile::writeColumn(m_encoded, atoms.x, m_indices, m_position_step, m_words);
+        TrajectoryFile::writeColumn(m_encoded, atoms.y, m_indices, m_position_step, m_words);
+
+        if (m_is_writing_velocities) {
+            TrajectoryFile::writeColumn(m_encoded, atoms.vx, m_indices, m_velocity_step, m_words);
+            TrajectoryFile::writeColumn(m_encoded, atoms.vy, m_indices, m_velocity_step, m_words);
+        }
+
+        // the size of the payload goes into the header
+        uint64_t size = buffer.size() - sizeof(TrajectoryFile::FrameHeader);
+        std::memcpy(buffer.data() + offsetof(TrajectoryFile::FrameHeader, size), &size, sizeof(size));
+    }
+
+public:
+    // steps are the largest rounding errors of coordinates and velocities, a step of zero stores exact values
+    explicit TrajectoryWriter(std::filesystem::path path, double position_step = 1e-3, double velocity_step = 1e-3,
+                              bool is_writing_velocities = true) :
+            m_path(std::move(path)), m_position_step(position_step), m_velocity_step(velocity_step),
+            m_is_writing_velocities(is_writing_velocities) {
+        open();
+    }
+
+    TrajectoryWriter(const TrajectoryWriter &) = delete;
+
+    TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+
+    ~TrajectoryWriter() {
+        wait();
+    }
+
+    void write(const ParticleStorage &atoms, int iteration, double time, sf::Vector2d box_size) {
+        if (m_is_failed)
+            return;
+
+        // encoding does not touch the file, so it overlaps with the previous write
+        encode(atoms, iteration, time, box_size);
+
+        if (!wait())
+            return;
+
+        if (!m_frames.empty() && m_frames.back().iteration >= iteration) {
+            auto first_dropped = std::lower_bound(
+                    m_frames.begin(), m_frames.end(), iteration,
+                    [](const TrajectoryFrameInfo &frame, int value) { return frame.iteration < value; }
+            );
+
+            uint64_t end = first_dropped->offset;
+            m_frames.erase(first_dropped, m_frames.end());
+
+            truncate(end);
+
+            if (m_is_failed)
+                return;
+        }
+
+        std::swap(m_encoded, m_writing);
+
+        uint64_t size = m_writing.getBuffer().size();
+        m_frames.push_back({m_end, size - sizeof(TrajectoryFile::FrameHeader), iteration, time});
+        m_end += size;
+
+        m_pending = std::async(std::launch::async, [this]() {
+            m_file.write(m_writing.getBuffer().data(), (std::streamsize) m_writing.getBuffer().size());
+            m_file.flush();
+
+            return (bool) m_file;
+        });
+    }
+
+    // waits for the frame being written, returns false once any write has failed
+    bool wait() {
+        if (m_pending.valid())
+            m_is_failed |= !m_pending.get();
+
+        return !m_is_failed;
+    }
+
+    [[nodiscard]] size_t getFramesCount() const {
+        return m_frames.size();
+    }
+
+    // bytes in the file once the pending write is finished
+    [[nodiscard]] uint64_t getFileSize() const {
+        return m_end;
+    }
+
+    [[nodiscard]] bool isFailed() const {
+        return m_is_failed;
+    }
+};
+
+// Random access to the frames of a trajectory file, also of one that is still being written.
+class TrajectoryReader {
+private:
+    std::ifstream m_file;
+    bool m_is_open{false};
+
+    std::vector<TrajectoryFrameInfo> m_frames;
+    uint64_t m_end{TrajectoryFile::FILE_HEADER_SIZE};
+
+    std::vector<char> m_buffer;
+    std::vector<uint64_t> m_words;
+    std::vector<uint8_t> m_bytes;
+
+public:
+    explicit TrajectoryReader(const std::filesystem::path &path) : m_file(path, std::ios::binary) {
+        m_is_open = TrajectoryFile::hasValidHeader(m_file);
+
+        refresh();
+    }
+
+    // lists the frames appended since the last call
+    void refresh() {
+        if (m_is_open)
+            m_end = TrajectoryFile::scanFrames(m_file, m_end, m_frames);
+    }
+
+    [[nodiscard]] bool isOpen() const {
+        return m_is_open;
+    }
+
+    [[nodiscard]] size_t getFramesCount() const {
+        return m_frames.size();
+    }
+
+    [[nodiscard]] const TrajectoryFrameInfo &getFrameInfo(size_t index) const {
+        return m_frames[index];
+    }
+
+    // index of the first frame at or after the iteration, getFramesCount() if there is none
+    [[nodiscard]] size_t findFrame(int iteration) const {
+        return std::lower_bound(
+                m_frames.begin(), m_frames.end(), iteration,
+                [](const TrajectoryFrameInfo &frame, int value) { return frame.iteration < value; }
+        ) - m_frames.begin();
+    }
+
+    // returns false if the frame is damaged, the frame is left in an unspecified state then
+    bool readFrame(size_t index, TrajectoryFrame &frame) {
+        if (index >= m_frames.size())
+            return false;
+
+        const auto &info = m_frames[index];
+
+        m_buffer.resize(info.size);
+
+        m_file.clear();
+        m_file.seekg((std::streamoff) (info.offset + sizeof(TrajectoryFile::FrameHeader)));
+        m_file.read(m_buffer.data(), (std::streamsize) info.size);
+
+        if (!m_file)
+            return false;
+
+        BinaryReader reader(m_buffer.data(), m_buffer.size());
+
+        frame.iteration = info.iteration;
+        frame.time = info.time;
+        frame.box_size = reader.read<sf::Vector2d>();
+
+        auto count = reader.read<uint64_t>();
+        frame.has_velocities = reader.read<uint8_t>();
+
+        // every atom takes at least a byte of ids
+        if (reader.isFailed() || count > info.size)
+            return false;
+
+        TrajectoryFile::readIds(reader, frame.id, count, m_bytes);
+        TrajectoryFile::readTypes(reader, frame.type, count, m_bytes);
+
+        TrajectoryFile::readColumn(reader, frame.x, count, m_words);
+        TrajectoryFile::readColumn(reader, frame.y, count, m_words);
+
+        if (frame.has_velocities) {
+            TrajectoryFile::readColumn(reader, frame.vx, count, m_words);
+            TrajectoryFile::readColumn(reader, frame.vy, count, m_words);
+        } else {
+            frame.vx.clear();
+            frame.vy.clear();
+        }
+
+        return !reader.isFailed() && reader.isAtEnd();
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_TRAJECTORYFILE_H
@@ -0,0 +1,92 @@
+#ifndef PHYSICSSIMULATION_WORKPARTITION_H
+#define PHYSICSSIMULATION_WORKPARTITION_H
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+enum class WorkScheduling {
+    // every thread gets the same number of atoms
+    EQUAL,
+    // intervals are chosen so that every thread gets the same estimated cost
+    COST_WEIGHTED,
+    // threads take small chunks of atoms from a shared counter until none are left;
+    // the assignment changes from run to run, so forces are not reproducible with per thread buffers
+    DYNAMIC_CHUNKS
+};
+
+// Splits atoms [0, size) between threads into contiguous intervals of approximately equal cost.
+class WorkPartition {
+private:
+    std::vector<double> m_prefix_costs;
+    std::vector<int> m_bounds;
+
+    std::atomic<int> m_next_chunk{0};
+    int m_chunk_size{1};
+    int m_size{0};
+
+public:
+    // cost(i) estimates the amount of work needed for atom i
+    template<class Cost>
+    void build(int size, unsigned int threads_count, Cost &&cost) {
+        m_size = size;
+
+        m_prefix_costs.resize(size + 1);
+        m_prefix_costs[0] = 0;
+
+        for (int i = 0; i < size; ++i) {
+            m_prefix_costs[i + 1] = m_prefix_costs[i] + cost(i);
+        }
+
+        m_bounds.resize(threads_count + 1);
+        m_bounds[0] = 0;
+        m_bounds[threads_count] = size;
+
+        double total_cost = m_prefix_costs[size];
+
+        for (unsigned int thread = 1; thread < threads_count; ++thread) {
+            double target = total_cost * thread / threads_count;
+
+            m_bounds[thread] = (int) (std::lower_bound(m_prefix_costs.begin(), m_prefix_costs.end(), target) -
+                                      m_prefix_costs.begin());
+            m_bounds[thread] = std::clamp(m_bounds[thread], m_bounds[thread - 1], size);
+        }
+    }
+
+    void buildEqual(int size, unsigned int threads_count) {
+        m_size = size;
+
+        m_bounds.resize(threads_count + 1);
+
+        int count_per_thread = (int) (size / threads_count);
+
+        for (unsigned int thread = 0; thread < threads_count; ++thread) {
+            m_bounds[thread] = count_per_thread * (int) thread;
+        }
+
+        m_bounds[threads_count] = size;
+    }
+
+    void buildChunks(int size, unsigned int threads_count) {
+        m_size = size;
+
+        // many more chunks than threads, but large enough to keep the shared counter cold
+        m_chunk_size = std::max(16, size / (int) (16 * threads_count));
+        m_next_chunk = 0;
+    }
+
+    [[nodiscard]] std::pair<int, int> getInterval(unsigned int thread_index) const {
+        return {m_bounds[thread_index], m_bounds[thread_index + 1]};
+    }
+
+    // returns an empty interval when all chunks are taken
+    std::pair<int, int> takeChunk() {
+        int begin = std::min(m_next_chunk.fetch_add(m_chunk_size, std::memory_order_relaxed), m_size);
+
+        return {begin, std::min(begin + m_chunk_size, m_size)};
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_WORKPARTITION_H
@@ -1,10 +1,38 @@
 #ifndef PHYSICSSIMULATION_WORLDDATA_H
 #define PHYSICSSIMULATION_WORLDDATA_H
 
+#include <algorithm>
 #include <map>
+#include <stdexcept>
+#include <thread>
 
 #include "Atom.h"
+#include "BinaryStream.h"
 #include "InteractionInfo.h"
+#include "InteractionTable.h"
+#include "NeighbourList.h"
+#include "PeriodicBox.h"
+#include "TimeStepController.h"
+#include "WorkPartition.h"
+
+enum class ForceAccumulation {
+    // every pair is computed once and applied to both atoms through private buffers of the threads,
+    // which are then summed in a fixed order: reproducible for a fixed number of threads
+    PER_THREAD_BUFFERS,
+    // every thread computes full forces of its own atoms, so each pair is computed twice,
+    // but the result is bitwise identical for any number of threads
+    OWNER_COMPUTES,
+    // per thread buffers for a few threads, owner computes for many, when the buffers would take
+    // threads * atoms of memory and their sums would not scale
+    AUTOMATIC
+};
+
+enum class Integrator {
+    // four force evaluations per step
+    RUNGE_KUTTA,
+    // symplectic, one force evaluation per step: forces of the end of a step are reused in the next one
+    VELOCITY_VERLET
+};
 
 class WorldData {
 private:
@@ -12,20 +40,58 @@ private:
     bool m_is_colliding_with_walls{true};
     bool m_is_gravity_enabled{true};
     bool m_is_colliding_with_moving_wall{true};
+    // periodic boundaries replace the walls and the moving wall
+    bool m_is_periodic{false};
+    bool m_is_using_cell_list{true};
+    bool m_is_using_neighbour_list{false};
+    bool m_is_using_simd_kernel{false};
+    double m_neighbour_list_skin{15.};
+    NeighbourListRebuildPolicy m_neighbour_list_rebuild_policy{NeighbourListRebuildPolicy::AUTOMATIC};
     double m_dt{0.01};
+    Integrator m_integrator{Integrator::RUNGE_KUTTA};
+    // when enabled m_dt is only the first step, the following ones are chosen by the controller
+    bool m_is_using_adaptive_time_delta{false};
+    TimeStepController m_time_step_controller;
+    // 0 means one thread per hardware thread
+    unsigned int m_threads_count{0};
+    ForceAccumulation m_force_accumulation{ForceAccumulation::AUTOMATIC};
+    // above this number of threads AUTOMATIC accumulation switches to owner computes
+    static constexpr unsigned int MAX_BUFFERED_THREADS_COUNT = 8;
+    WorkScheduling m_work_scheduling{WorkScheduling::COST_WEIGHTED};
 
     std::map<std::pair<AtomType, AtomType>, InteractionInfo> m_interactions{
             {{AtomType::BODY,  AtomType::BODY},  InteractionInfo(48, 1000)},
+            {{AtomType::BODY,  AtomType::WALL},  InteractionInfo(48, 1000)},
     };
 
+    // species declared in AtomType, new ones are registered at runtime
+    size_t m_species_count{(size_t) AtomType::BODY + 1};
+    InteractionTable m_interaction_table;
+
     sf::Vector2d m_box_size{1000, 1000};
+
+    // throws after restoring the previous settings when the periodic box has become too small for the interactions
+    template<class Restore>
+    void checkMinimumImage(Restore &&restore) {
+        if (isMinimumImageValid())
+            return;
+
+        restore();
+
+        throw std::invalid_argument(
+                "the cutoff plus the neighbour list skin must be less than half of the periodic box");
+    }
 public:
+    WorldData() {
+        m_interaction_table.build(m_interactions, m_species_count);
+    }
+
     [[nodiscard]] int getIterationsPerImpulseMeasurements() const {
         return iterations_per_impulse_measurements;
     }
 
     [[nodiscard]] bool isCollidingWithWalls() const {
-        return m_is_colliding_with_walls;
+        return m_is_colliding_with_walls && !m_is_periodic;
     }
 
     [[nodiscard]] bool isGravityEnabled() const {
@@ -33,25 +99,112 @@ public:
     }
 
     [[nodiscard]] bool isCollidingWithMovingWall() const {
-        return m_is_colliding_with_moving_wall;
+        return m_is_colliding_with_moving_wall && !m_is_periodic;
+    }
+
+    [[nodiscard]] bool isPeriodic() const {
+        return m_is_periodic;
+    }
+
+    [[nodiscard]] bool isUsingCellList() const {
+        return m_is_using_cell_list;
+    }
+
+    [[nodiscard]] bool isUsingNeighbourList() const {
+        return m_is_using_neighbour_list;
+    }
+
+    [[nodiscard]] bool isUsingSimdKernel() const {
+        return m_is_using_simd_kernel;
+    }
+
+    [[nodiscard]] double getNeighbourListSkin() const {
+        return m_neighbour_list_skin;
+    }
+
+    [[nodiscard]] NeighbourListRebuildPolicy getNeighbourListRebuildPolicy() const {
+        return m_neighbour_list_rebuild_policy;
     }
 
     [[nodiscard]] double getTimeDelta() const {
         return m_dt;
     }
 
+    [[nodiscard]] Integrator getIntegrator() const {
+        return m_integrator;
+    }
+
+    [[nodiscard]] bool isUsingAdaptiveTimeDelta() const {
+        return m_is_using_adaptive_time_delta;
+    }
+
+    [[nodiscard]] const TimeStepController &getTimeStepController() const {
+        return m_time_step_controller;
+    }
+
+    TimeStepController &getTimeStepController() {
+        return m_time_step_controller;
+    }
+
+    [[nodiscard]] unsigned int getThreadsCount() const {
+        return m_threads_count == 0 ? std::max(1u, std::thread::hardware_concurrency()) : m_threads_count;
+    }
+
+    [[nodiscard]] ForceAccumulation getForceAccumulation() const {
+        return m_force_accumulation;
+    }
+
+    // the accumulation used for the current number of threads, never AUTOMATIC
+    [[nodiscard]] ForceAccumulation getEffectiveForceAccumulation() const {
+        if (m_force_accumulation != ForceAccumulation::AUTOMATIC)
+            return m_force_accumulation;
+
+        return getThreadsCount() > MAX_BUFFERED_THREADS_COUNT ? ForceAccumulation::OWNER_COMPUTES
+                                                              : ForceAccumulation::PER_THREAD_BUFFERS;
+    }
+
+    [[nodiscard]] WorkScheduling getWorkScheduling() const {
+        return m_work_scheduling;
+    }
+
     [[nodiscard]] const std::map<std::pair<AtomType, AtomType>, InteractionInfo> &getInteractions() const {
         return m_interactions;
     }
 
     [[nodiscard]] const InteractionInfo &getInteraction(const AtomType &first, const AtomType &second) const {
-        return m_interactions.find({first, second})->second;
+        return m_interaction_table.get(first, second);
+    }
+
+    [[nodiscard]] double getMaxCutoff() const {
+        return m_interaction_table.getMaxCutoff();
+    }
+
+    [[nodiscard]] bool hasTabulatedPotentials() const {
+        return m_interaction_table.hasTabulatedPotentials();
+    }
+
+    [[nodiscard]] size_t getSpeciesCount() const {
+        return m_species_count;
     }
 
     [[nodiscard]] const sf::Vector2d &getBoxSize() const {
         return m_box_size;
     }
 
+    [[nodiscard]] PeriodicBox getPeriodicBox() const {
+        return {m_box_size, m_is_periodic};
+    }
+
+    // distances in a periodic box are taken to the nearest image only, so no atom may reach two images of another
+    [[nodiscard]] bool isMinimumImageValid() const {
+        if (!m_is_periodic)
+            return true;
+
+        double range = getMaxCutoff() + (m_is_using_neighbour_list ? m_neighbour_list_skin : 0.);
+
+        return range < std::min(m_box_size.x, m_box_size.y) / 2.;
+    }
+
 
     void setIterationsPerImpulseMeasurements(int iterationsPerImpulseMeasurements) {
         iterations_per_impulse_measurements = iterationsPerImpulseMeasurements;
@@ -69,12 +222,185 @@ public:
         m_is_colliding_with_moving_wall = isCollidingWithMovingWall;
     }
 
+    // throws std::invalid_argument when the box is too small for the interactions, see isMinimumImageValid
+    void setIsPeriodic(bool isPeriodic) {
+        bool previous = m_is_periodic;
+        m_is_periodic = isPeriodic;
+
+        checkMinimumImage([&]() { m_is_periodic = previous; });
+    }
+
+    void setIsUsingCellList(bool isUsingCellList) {
+        m_is_using_cell_list = isUsingCellList;
+    }
+
+    void setIsUsingNeighbourList(bool isUsingNeighbourList) {
+        bool previous = m_is_using_neighbour_list;
+        m_is_using_neighbour_list = isUsingNeighbourList;
+
+        checkMinimumImage([&]() { m_is_using_neighbour_list = previous; });
+    }
+
+    void setIsUsingSimdKernel(bool isUsingSimdKernel) {
+        m_is_using_simd_kernel = isUsingSimdKernel;
+    }
+
+    void setNeighbourListSkin(double skin) {
+        double previous = m_neighbour_list_skin;
+        m_neighbour_list_skin = skin;
+
+        checkMinimumImage([&]() { m_neighbour_list_skin = previous; });
+    }
+
+    void setNeighbourListRebuildPolicy(NeighbourListRebuildPolicy policy) {
+        m_neighbour_list_rebuild_policy = policy;
+    }
+
     void setTimeDelta(double dt) {
         m_dt = dt;
     }
 
+    void setIntegrator(Integrator integrator) {
+        m_integrator = integrator;
+    }
+
+    void setIsUsingAdaptiveTimeDelta(bool isUsingAdaptiveTimeDelta) {
+        m_is_using_adaptive_time_delta = isUsingAdaptiveTimeDelta;
+    }
+
+    void setThreadsCount(unsigned int threadsCount) {
+        m_threads_count = threadsCount;
+    }
+
+    void setForceAccumulation(ForceAccumulation forceAccumulation) {
+        m_force_accumulation = forceAccumulation;
+    }
+
+    void setWorkScheduling(WorkScheduling workScheduling) {
+        m_work_scheduling = workScheduling;
+    }
+
+    // returns the type of the new species, its interactions must be set with setInteraction
+    AtomType registerSpecies() {
+        AtomType type = AtomType(m_species_count++);
+
+        m_interaction_table.build(m_interactions, m_species_count);
+
+        return type;
+    }
+
+    // interactions are symmetric, so the order of types does not matter
+    void setInteraction(AtomType first, AtomType second, const InteractionInfo &interaction) {
+        auto previous = m_interactions;
+
+        m_interactions.erase({second, first});
+        m_interactions.erase({first, second});
+        m_interactions.emplace(std::make_pair(first, second), interaction);
+
+        m_interaction_table.build(m_interactions, m_species_count);
+
+        checkMinimumImage([&]() {
+            m_interactions = previous;
+            m_interaction_table.build(m_interactions, m_species_count);
+        });
+    }
+
     void setBoxSize(const sf::Vector2d &boxSize) {
+        sf::Vector2d previous = m_box_size;
         m_box_size = boxSize;
+
+        checkMinimumImage([&]() { m_box_size = previous; });
+    }
+
+    void writeCheckpoint(BinaryWriter &writer) const {
+        writer.write<uint64_t>(m_species_count);
+        writer.write<uint64_t>(m_interactions.size());
+
+        // tables hold arbitrary functions, so only the fact that a pair has one is stored
+        for (auto &[types, interaction]: m_interactions) {
+            writer.write(types.first);
+            writer.write(types.second);
+            writer.write(interaction.SIGMA);
+            writer.write(interaction.EPSILON);
+            writer.write<bool>(interaction.POTENTIAL != nullptr);
+        }
+
+        writer.write(iterations_per_impulse_measurements);
+        writer.write(m_is_colliding_with_walls);
+        writer.write(m_is_gravity_enabled);
+        writer.write(m_is_colliding_with_moving_wall);
+        writer.write(m_is_periodic);
+        writer.write(m_is_using_cell_list);
+        writer.write(m_is_using_neighbour_list);
+        writer.write(m_is_using_simd_kernel);
+        writer.write(m_neighbour_list_skin);
+        writer.write(m_neighbour_list_rebuild_policy);
+        writer.write(m_dt);
+        writer.write(m_integrator);
+        writer.write(m_is_using_adaptive_time_delta);
+        writer.write(m_time_step_controller);
+        writer.write(m_threads_count);
+        writer.write(m_force_accumulation);
+        writer.write(m_work_scheduling);
+        writer.write(m_box_size);
+    }
+
+    // Tabulated potentials are taken from the current interactions, so they must be set before reading.
+    // Interactions are read first: when a table is missing the reader fails before anything is changed.
+    void readCheckpoint(BinaryReader &reader) {
+        auto species_count = reader.read<uint64_t>();
+
+        std::map<std::pair<AtomType, AtomType>, InteractionInfo> interactions;
+        auto interactions_count = reader.read<uint64_t>();
+
+        for (uint64_t i = 0; i < interactions_count && !reader.isFailed(); ++i) {
+            auto first = reader.read<AtomType>();
+            auto types = std::make_pair(first, reader.read<AtomType>());
+            auto sigma = reader.read<double>();
+            auto epsilon = reader.read<double>();
+            auto has_potential = reader.read<bool>();
+
+            std::shared_ptr<const PairPotentialTable> potential;
+
+            if (has_potential) {
+                auto it = m_interactions.find(types);
+
+                if (it == m_interactions.end() || !it->second.POTENTIAL) {
+                    reader.setFailed();
+                    break;
+                }
+
+                potential = it->second.POTENTIAL;
+            }
+
+            interactions.emplace(types, InteractionInfo(sigma, epsilon, potential));
+        }
+
+        if (reader.isFailed())
+            return;
+
+        m_species_count = species_count;
+        m_interactions = std::move(interactions);
+        m_interaction_table.build(m_interactions, m_species_count);
+
+        iterations_per_impulse_measurements = reader.read<int>();
+        m_is_colliding_with_walls = reader.read<bool>();
+        m_is_gravity_enabled = reader.read<bool>();
+        m_is_colliding_with_moving_wall = reader.read<bool>();
+        m_is_periodic = reader.read<bool>();
+        m_is_using_cell_list = reader.read<bool>();
+        m_is_using_neighbour_list = reader.read<bool>();
+        m_is_using_simd_kernel = reader.read<bool>();
+        m_neighbour_list_skin = reader.read<double>();
+        m_neighbour_list_rebuild_policy = reader.read<NeighbourListRebuildPolicy>();
+        m_dt = reader.read<double>();
+        m_integrator = reader.read<Integrator>();
+        m_is_using_adaptive_time_delta = reader.read<bool>();
+        m_time_step_controller = reader.read<TimeStepController>();
+        m_threads_count = reader.read<unsigned int>();
+        m_force_accumulation = reader.read<ForceAccumulation>();
+        m_work_scheduling = reader.read<WorkScheduling>();
+        m_box_size = reader.read<sf::Vector2d>();
     }
 };
 
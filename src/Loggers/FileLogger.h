@@ -1,32 +1,267 @@
 #ifndef PHYSICSSIMULATION_FILELOGGER_H
 #define PHYSICSSIMULATION_FILELOGGER_H
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <filesystem>
-#include <fstream>
-#include <utility>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "Logger.h"
 
+// what survives a crash: FLUSHED hands every batch to the operating system, so it survives a crash
+// of the program, SYNCED also waits until the batch is on the disk, so it survives a crash of the system
+enum class LogDurability {
+    BUFFERED,
+    FLUSHED,
+    SYNCED
+};
+
+struct FileLoggerStatistics {
+    long long calls_count{0};
+    // time spent inside log() on the simulation thread
+    double total_seconds{0.};
+    double max_seconds{0.};
+
+    long long flushes_count{0};
+    // calls that waited because the buffer was full
+    long long stalls_count{0};
+
+    [[nodiscard]] double getAverageSeconds() const {
+        return calls_count == 0 ? 0. : total_seconds / (double) calls_count;
+    }
+};
+
+// Writes a row of observables per call. The simulation thread only puts the values into a ring buffer,
+// a background thread formats the rows and writes them through a handle that stays open.
+// Rows are written every flush interval or once half of the buffer is filled, whatever comes first.
 class FileLogger : public Logger {
 private:
-    std::filesystem::path m_path;
-    std::ofstream m_ofstream;
+    using Clock = std::chrono::steady_clock;
+
+    struct Record {
+        int iteration;
+        double time;
+        double energy;
+        double temperature;
+        double pressure;
+        double density;
+    };
+
+    std::FILE *m_file{nullptr};
+
+    std::chrono::milliseconds m_flush_interval;
+    LogDurability m_durability;
+
+    std::vector<Record> m_records;
+    size_t m_head{0};
+    size_t m_count{0};
+
+    // rows put into the buffer and rows written, flush() waits until they are equal
+    long long m_pushed_count{0};
+    long long m_written_count{0};
+    bool m_is_flush_requested{false};
+    bool m_is_stopping{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_flush_condition;
+    std::condition_variable m_space_condition;
+
+    FileLoggerStatistics m_statistics;
+
+    // the last member, so that everything it uses is constructed before it starts
+    std::thread m_thread;
+
+    static void appendNumber(std::string &line, double value) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+
+        line.append(buffer, result.ptr);
+    }
+
+    static void appendRecord(std::string &text, const Record &record) {
+        char buffer[16];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), record.iteration);
+        text.append(buffer, result.ptr);
+
+        for (double value: {record.time, record.energy, record.temperature, record.pressure, record.density}) {
+            text += '\t';
+            appendNumber(text, value);
+        }
+
+        text += '\n';
+    }
+
+    void write(const std::string &text) {
+        std::fwrite(text.data(), 1, text.size(), m_file);
+
+        if (m_durability != LogDurability::BUFFERED)
+            std::fflush(m_file);
+
+        if (m_durability == LogDurability::SYNCED) {
+#ifdef _WIN32
+            _commit(_fileno(m_file));
+#else
+            fsync(fileno(m_file));
+#endif
+        }
+    }
+
+    void work() {
+        std::vector<Record> batch;
+        batch.reserve(m_records.size());
+
+        std::string text;
+
+        std::unique_lock lock(m_mutex);
+
+        while (true) {
+            m_flush_condition.wait_for(lock, m_flush_interval, [this]() {
+                return m_is_stopping || m_is_flush_requested || 2 * m_count >= m_records.size();
+            });
+
+            // rows are formatted and written without the lock, so log() never waits for the disk
+            batch.clear();
+
+            for (size_t k = 0; k < m_count; ++k) {
+                batch.push_back(m_records[(m_head + m_records.size() - m_count + k) % m_records.size()]);
+            }
+
+            m_count = 0;
+            m_is_flush_requested = false;
+
+            bool is_stopping = m_is_stopping;
+
+            lock.unlock();
+            m_space_condition.notify_all();
+
+            if (!batch.empty()) {
+                text.clear();
+
+                for (auto &record: batch) {
+                    appendRecord(text, record);
+                }
+
+                write(text);
+            }
+
+            lock.lock();
+
+            m_written_count += (long long) batch.size();
+            m_statistics.flushes_count += !batch.empty();
+
+            m_space_condition.notify_all();
+
+            if (is_stopping)
+                return;
+        }
+    }
 
 public:
-    explicit FileLogger(std::filesystem::path path) : m_path(std::move(path)) {
-        m_ofstream.open(m_path, std::ios_base::app);
+    explicit FileLogger(const std::filesystem::path &path,
+                        std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000),
+                        LogDurability durability = LogDurability::FLUSHED, size_t capacity = 4096) :
+            m_flush_interval(flush_interval), m_durability(durability), m_records(std::max<size_t>(capacity, 2)) {
+        std::error_code error;
+        bool is_new = !std::filesystem::exists(path, error) || std::filesystem::file_size(path, error) == 0;
+
+        m_file = std::fopen(path.string().c_str(), "ab");
+
+        // the header is written once, so a continued run appends rows to the same table
+        if (m_file && is_new)
+            write("iteration\ttime\tenergy\ttemperature\tpressure\tdensity\n");
+
+        if (m_file)
+            m_thread = std::thread(&FileLogger::work, this);
+    }
+
+    FileLogger(const FileLogger &) = delete;
+
+    FileLogger &operator=(const FileLogger &) = delete;
+
+    ~FileLogger() override {
+        if (!m_file)
+            return;
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_is_stopping = true;
+        }
 
-        m_ofstream << "Total energy:\n";
+        m_flush_condition.notify_one();
+        m_thread.join();
 
-        m_ofstream.close();
+        std::fclose(m_file);
     }
 
-    void log(const World &world, int iteration) override {
-        m_ofstream.open(m_path, std::ios_base::app);
+    // the pressure is the virial one
+    void log(const WorldSnapshot &snapshot) override {
+        if (!m_file)
+            return;
+
+        auto start = Clock::now();
+
+        Record record{snapshot.getIteration(), snapshot.getTime(), snapshot.getTotalEnergy(),
+                      snapshot.getTemperature(), snapshot.getVirialPressure(), snapshot.getDensity()};
+
+        std::unique_lock lock(m_mutex);
+
+        // rows are never dropped: when the disk falls behind the simulation waits for it
+        if (m_count == m_records.size()) {
+            m_statistics.stalls_count++;
+            m_flush_condition.notify_one();
+
+            m_space_condition.wait(lock, [this]() { return m_count < m_records.size(); });
+        }
+
+        m_records[m_head] = record;
+        m_head = (m_head + 1) % m_records.size();
+        m_count++;
+        m_pushed_count++;
+
+        if (2 * m_count >= m_records.size())
+            m_flush_condition.notify_one();
+
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        m_statistics.calls_count++;
+        m_statistics.total_seconds += seconds;
+        m_statistics.max_seconds = std::max(m_statistics.max_seconds, seconds);
+    }
+
+    // writes all logged rows now and waits until they are written with the chosen durability
+    void flush() {
+        if (!m_file)
+            return;
+
+        std::unique_lock lock(m_mutex);
+
+        m_is_flush_requested = true;
+        m_flush_condition.notify_one();
+
+        long long target = m_pushed_count;
+        m_space_condition.wait(lock, [this, target]() { return m_written_count >= target; });
+    }
+
+    [[nodiscard]] bool isOpen() const {
+        return m_file != nullptr;
+    }
 
-        m_ofstream << std::fixed << std::setprecision(9) << world.getTotalEnergy() << "\n";
+    [[nodiscard]] FileLoggerStatistics getStatistics() {
+        std::lock_guard lock(m_mutex);
 
-        m_ofstream.close();
+        return m_statistics;
     }
 };
 
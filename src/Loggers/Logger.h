@@ -1,11 +1,12 @@
 #ifndef PHYSICSSIMULATION_LOGGER_H
 #define PHYSICSSIMULATION_LOGGER_H
 
-#include "World.h"
+#include "WorldSnapshot.h"
 
+// Loggers get a snapshot, so that they can run on their own thread while the world goes on.
 class Logger {
 public:
-    virtual void log(const World &world, int iteration) = 0;
+    virtual void log(const WorldSnapshot &snapshot) = 0;
 
     virtual ~Logger() = default;
 };
@@ -12,12 +12,13 @@ protected:
 public:
     explicit TerminalLogger(double energy) : m_energy(energy) {}
 
-    void log(const World &world, int iteration) override {
-        double current_energy = world.getTotalEnergy();
+    void log(const WorldSnapshot &snapshot) override {
+        double current_energy = snapshot.getTotalEnergy();
 
-        std::cout << std::setprecision(9) << iteration << ": "
+        std::cout << std::setprecision(9) << snapshot.getIteration() << ": "
                   << "energy: " << current_energy
-                  << "; delta (%): " << (current_energy - m_energy) / m_energy * 100 << std::endl;
+                  << "; delta (%): " << (current_energy - m_energy) / m_energy * 100
+                  << "; dt: " << snapshot.getTimeDelta() << std::endl;
     }
 };
 
@@ -0,0 +1,27 @@
+#ifndef PHYSICSSIMULATION_TRAJECTORYLOGGER_H
+#define PHYSICSSIMULATION_TRAJECTORYLOGGER_H
+
+#include <filesystem>
+#include <utility>
+
+#include "Logger.h"
+#include "Helpers/TrajectoryFile.h"
+
+// Saves positions, velocities and types of all atoms every time it is called, see TrajectoryWriter.
+// Frames are read back with TrajectoryReader.
+class TrajectoryLogger : public Logger {
+private:
+    TrajectoryWriter m_writer;
+
+public:
+    explicit TrajectoryLogger(std::filesystem::path path, double position_step = 1e-3, double velocity_step = 1e-3,
+                              bool is_writing_velocities = true) :
+            m_writer(std::move(path), position_step, velocity_step, is_writing_velocities) {}
+
+    void log(const WorldSnapshot &snapshot) override {
+        m_writer.write(snapshot.getAtoms(), snapshot.getIteration(), snapshot.getTime(), snapshot.getBoxSize());
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_TRAJECTORYLOGGER_H
@@ -0,0 +1,290 @@
+#ifndef PHYSICSSIMULATION_PARTICLESTORAGE_H
+#define PHYSICSSIMULATION_PARTICLESTORAGE_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "Atom.h"
+#include "Helpers/AlignedAllocator.h"
+#include "Helpers/BinaryStream.h"
+
+// Structure of arrays storage of atoms: every property lives in its own aligned array,
+// so the force loop streams only the coordinates it needs.
+// Atom objects are assembled on demand for code that works with single atoms.
+// Every atom gets an id that does not change when other atoms are removed. Removed atoms are only
+// marked as dead (tombstones), so indices stay valid until compact() is called.
+class ParticleStorage {
+private:
+    int m_next_id{0};
+    size_t m_tombstones_count{0};
+
+    // new index of every atom after the last compaction, -1 for removed ones
+    std::vector<int> m_new_indices;
+
+public:
+    AlignedVector<double> x;
+    AlignedVector<double> y;
+
+    AlignedVector<double> vx;
+    AlignedVector<double> vy;
+
+    AlignedVector<double> mass;
+    AlignedVector<AtomType> type;
+
+    AlignedVector<int> id;
+    AlignedVector<unsigned char> is_alive;
+
+    class Iterator {
+    private:
+        const ParticleStorage *m_storage;
+        size_t m_index;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Atom;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Atom;
+
+        // dead atoms are skipped
+        Iterator(const ParticleStorage *storage, size_t index) : m_storage(storage), m_index(index) {
+            skipDead();
+        }
+
+        void skipDead() {
+            while (m_index < m_storage->size() && !m_storage->is_alive[m_index]) {
+                ++m_index;
+            }
+        }
+
+        Atom operator*() const {
+            return m_storage->getAtom(m_index);
+        }
+
+        Iterator &operator++() {
+            ++m_index;
+            skipDead();
+
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return m_index == other.m_index;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return m_index != other.m_index;
+        }
+    };
+
+    ParticleStorage() = default;
+
+    explicit ParticleStorage(const std::vector<Atom> &atoms) {
+        assign(atoms);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return x.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return x.empty();
+    }
+
+    [[nodiscard]] size_t getAliveCount() const {
+        return size() - m_tombstones_count;
+    }
+
+    [[nodiscard]] size_t getTombstonesCount() const {
+        return m_tombstones_count;
+    }
+
+    void assign(const std::vector<Atom> &atoms) {
+        clear();
+        reserve(atoms.size());
+
+        for (auto &atom: atoms) {
+            push_back(atom);
+        }
+    }
+
+    void reserve(size_t capacity) {
+        x.reserve(capacity);
+        y.reserve(capacity);
+        vx.reserve(capacity);
+        vy.reserve(capacity);
+        mass.reserve(capacity);
+        type.reserve(capacity);
+        id.reserve(capacity);
+        is_alive.reserve(capacity);
+    }
+
+    void clear() {
+        x.clear();
+        y.clear();
+        vx.clear();
+        vy.clear();
+        mass.clear();
+        type.clear();
+        id.clear();
+        is_alive.clear();
+
+        m_next_id = 0;
+        m_tombstones_count = 0;
+    }
+
+    void push_back(const Atom &atom) {
+        x.push_back(atom.position.x);
+        y.push_back(atom.position.y);
+        vx.push_back(atom.speed.x);
+        vy.push_back(atom.speed.y);
+        mass.push_back(atom.mass);
+        type.push_back(atom.type);
+        id.push_back(m_next_id++);
+        is_alive.push_back(1);
+    }
+
+    [[nodiscard]] Atom getAtom(size_t i) const {
+        Atom atom;
+
+        atom.position = {x[i], y[i]};
+        atom.speed = {vx[i], vy[i]};
+        atom.mass = mass[i];
+        atom.type = type[i];
+
+        return atom;
+    }
+
+    void setAtom(size_t i, const Atom &atom) {
+        x[i] = atom.position.x;
+        y[i] = atom.position.y;
+        vx[i] = atom.speed.x;
+        vy[i] = atom.speed.y;
+        mass[i] = atom.mass;
+        type[i] = atom.type;
+    }
+
+    // only alive atoms
+    [[nodiscard]] std::vector<Atom> toVector() const {
+        return {begin(), end()};
+    }
+
+    Atom operator[](size_t i) const {
+        return getAtom(i);
+    }
+
+    [[nodiscard]] Iterator begin() const {
+        return {this, 0};
+    }
+
+    [[nodiscard]] Iterator end() const {
+        return {this, size()};
+    }
+
+    [[nodiscard]] sf::Vector2d getPosition(size_t i) const {
+        return {x[i], y[i]};
+    }
+
+    [[nodiscard]] sf::Vector2d getSpeed(size_t i) const {
+        return {vx[i], vy[i]};
+    }
+
+    void movePosition(size_t i, const sf::Vector2d &delta) {
+        x[i] += delta.x;
+        y[i] += delta.y;
+    }
+
+    void addSpeed(size_t i, const sf::Vector2d &delta) {
+        vx[i] += delta.x;
+        vy[i] += delta.y;
+    }
+
+    [[nodiscard]] double getKineticEnergy(size_t i) const {
+        return mass[i] * (vx[i] * vx[i] + vy[i] * vy[i]) / 2.;
+    }
+
+    // marks the atom as dead: it stops moving and interacting, but keeps its index until compaction
+    void remove(size_t i) {
+        if (!is_alive[i])
+            return;
+
+        is_alive[i] = 0;
+        vx[i] = 0;
+        vy[i] = 0;
+
+        m_tombstones_count++;
+    }
+
+    // drops dead atoms keeping the order of the others;
+    // returns the new index of every old one, -1 for dropped atoms
+    const std::vector<int> &compact() {
+        m_new_indices.resize(size());
+
+        size_t kept = 0;
+
+        for (size_t i = 0; i < size(); ++i) {
+            if (!is_alive[i]) {
+                m_new_indices[i] = -1;
+                continue;
+            }
+
+            if (kept != i) {
+                x[kept] = x[i];
+                y[kept] = y[i];
+                vx[kept] = vx[i];
+                vy[kept] = vy[i];
+                mass[kept] = mass[i];
+                type[kept] = type[i];
+                id[kept] = id[i];
+                is_alive[kept] = 1;
+            }
+
+            m_new_indices[i] = (int) kept++;
+        }
+
+        x.resize(kept);
+        y.resize(kept);
+        vx.resize(kept);
+        vy.resize(kept);
+        mass.resize(kept);
+        type.resize(kept);
+        id.resize(kept);
+        is_alive.resize(kept);
+
+        m_tombstones_count = 0;
+
+        return m_new_indices;
+    }
+
+    void writeCheckpoint(BinaryWriter &writer) const {
+        writer.write(m_next_id);
+        writer.write<uint64_t>(m_tombstones_count);
+
+        writer.writeVector(x);
+        writer.writeVector(y);
+        writer.writeVector(vx);
+        writer.writeVector(vy);
+        writer.writeVector(mass);
+        writer.writeVector(type);
+        writer.writeVector(id);
+        writer.writeVector(is_alive);
+    }
+
+    void readCheckpoint(BinaryReader &reader) {
+        m_next_id = reader.read<int>();
+        m_tombstones_count = reader.read<uint64_t>();
+
+        reader.readVector(x);
+        reader.readVector(y);
+        reader.readVector(vx);
+        reader.readVector(vy);
+        reader.readVector(mass);
+        reader.readVector(type);
+        reader.readVector(id);
+        reader.readVector(is_alive);
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_PARTICLESTORAGE_H
@@ -1,12 +1,20 @@
 #ifndef PHYSICSSIMULATION_SIMULATION_H
 #define PHYSICSSIMULATION_SIMULATION_H
 
-#include <type_traits>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <type_traits>
 
 #include "Drawers/Drawer.h"
 #include "Loggers/Logger.h"
+#include "Helpers/Checkpoint.h"
+#include "Helpers/SnapshotBuffer.h"
 #include "World.h"
+#include "WorldSnapshot.h"
 
 template<class T, class U>
 concept Derived = std::is_base_of_v<U, T>;
@@ -17,9 +25,32 @@ private:
     std::vector<std::unique_ptr<Logger>> m_loggers;
     World m_world;
 
-    const int m_iterations_per_frame{1000};
+    int m_iterations_per_frame{1000};
 
     int m_iteration{0};
+
+    // in the pipelined mode the world is simulated on its own thread, loggers run on another one
+    // and the drawer stays on the calling thread, they exchange snapshots through the buffers
+    bool m_is_pipelined{true};
+    SnapshotBuffer<WorldSnapshot> m_render_buffer{FrameDropPolicy::WAIT};
+    SnapshotBuffer<WorldSnapshot> m_log_buffer{FrameDropPolicy::WAIT};
+    // set by setFrameDropPolicies, otherwise the render policy follows the drawer
+    bool m_is_render_policy_chosen{false};
+    std::atomic<bool> m_is_stopping{false};
+
+    // used by the sequential mode
+    WorldSnapshot m_snapshot;
+
+    AsyncCheckpointWriter m_checkpoint_writer;
+    std::string m_checkpoint_path;
+    int m_iterations_per_checkpoint{0};
+    int m_last_checkpoint_iteration{0};
+
+    void saveScheduledCheckpoint() {
+        if (m_iterations_per_checkpoint > 0 &&
+            m_iteration - m_last_checkpoint_iteration >= m_iterations_per_checkpoint)
+            saveCheckpoint(m_checkpoint_path);
+    }
 public:
     template<class... Args>
     explicit Simulation(Args... args) :
@@ -28,6 +59,9 @@ public:
     template<Derived<Drawer> T, class... Args>
     void setDrawer(Args... args) {
         m_drawer = std::make_unique<T>(args...);
+
+        if (!m_is_render_policy_chosen)
+            m_render_buffer.setPolicy(m_drawer->isInteractive() ? FrameDropPolicy::DROP_OLDEST : FrameDropPolicy::WAIT);
     }
 
     template<Derived<Logger> T, class... Args>
@@ -45,55 +79,206 @@ public:
         return m_world;
     }
 
+    [[nodiscard]] int getIteration() const {
+        return m_iteration;
+    }
+
+    // checkpoints are written between frames, so the period is rounded up to whole frames; 0 disables them
+    void setCheckpointing(const std::string &path, int iterations_per_checkpoint) {
+        m_checkpoint_path = path;
+        m_iterations_per_checkpoint = iterations_per_checkpoint;
+        m_last_checkpoint_iteration = m_iteration;
+    }
+
+    // the state is serialized right away, the file is written in the background
+    void saveCheckpoint(const std::string &path) {
+        BinaryWriter writer = Checkpoint::startFile();
+
+        writer.write(m_iteration);
+        m_world.writeCheckpoint(writer);
+
+        Checkpoint::finishFile(writer);
+
+        m_checkpoint_writer.write(path, std::move(writer.getBuffer()));
+        m_last_checkpoint_iteration = m_iteration;
+    }
+
+    // waits for the checkpoint being written, returns whether it was written successfully
+    bool waitForCheckpoint() {
+        return m_checkpoint_writer.wait();
+    }
+
+    // Continues the run saved in the file: the following steps are bitwise identical to the uninterrupted run
+    // with the same number of threads. Returns false and keeps the current state if the file is missing,
+    // damaged, of another version or uses tabulated potentials that are not set in this simulation.
+    bool loadCheckpoint(const std::string &path) {
+        std::vector<char> file;
+
+        if (!Checkpoint::readFile(path, file))
+            return false;
+
+        BinaryReader reader = Checkpoint::openFile(file);
+
+        auto iteration = reader.read<int>();
+
+        if (reader.isFailed())
+            return false;
+
+        m_world.readCheckpoint(reader);
+
+        if (reader.isFailed())
+            return false;
+
+        m_iteration = iteration;
+        m_last_checkpoint_iteration = iteration;
+
+        return true;
+    }
+
+    void setIterationsPerFrame(int iterations_per_frame) {
+        m_iterations_per_frame = iterations_per_frame;
+    }
+
+    // Switches between running the world, loggers and the drawer on their own threads (the default)
+    // and running them one after another on the calling thread.
+    void setIsPipelined(bool isPipelined) {
+        m_is_pipelined = isPipelined;
+    }
+
+    // what the world does when a drawer or the loggers fall behind: by default frames are dropped only for
+    // an interactive drawer, the world waits for an image export and for the loggers, so that nothing is lost
+    void setFrameDropPolicies(FrameDropPolicy render_policy, FrameDropPolicy log_policy) {
+        m_render_buffer.setPolicy(render_policy);
+        m_log_buffer.setPolicy(log_policy);
+        m_is_render_policy_chosen = true;
+    }
+
+    [[nodiscard]] SnapshotBufferStatistics getRenderStatistics() {
+        return m_render_buffer.getStatistics();
+    }
+
+    [[nodiscard]] SnapshotBufferStatistics getLogStatistics() {
+        return m_log_buffer.getStatistics();
+    }
+
     void makeSimulationStep() {
         for (int i = 0; i < m_iterations_per_frame; ++i) {
             m_world.makeSimulationStep();
             m_iteration++;
         }
+
+        // computed once here and shared by all consumers, the next step reuses the forces
+        m_world.updateObservables();
     }
 
-    void writeToLog() {
+    void writeToLog(const WorldSnapshot &snapshot) {
         for (auto &logger: m_loggers) {
-            logger->log(m_world, m_iteration);
+            logger->log(snapshot);
         }
     }
 
-    void drawWorld() {
+    void drawWorld(const WorldSnapshot &snapshot) {
         if (!m_drawer)
             return;
 
         m_drawer->startDraw();
 
-        for (auto &atom: m_world.getAtoms()) {
-            m_drawer->drawAtom(atom, m_world.getWorldData().getBoxSize());
-        }
+        m_drawer->drawAtoms(snapshot.getAtoms(), snapshot.getBoxSize());
 
-        m_drawer->endDraw(m_iteration);
+        m_drawer->endDraw(snapshot.getIteration());
     }
 
+    // runs until the drawer is closed
     void startSimulation() {
-        while (!m_drawer || !m_drawer->wantsToClose()) {
+        startSimulationForIterationsCount(std::numeric_limits<int>::max());
+    }
+
+    // runs until the iteration counter reaches iterations_count, so after loadCheckpoint
+    // only the remaining iterations are made
+    void startSimulationForIterationsCount(int iterations_count) {
+        if (m_is_pipelined)
+            runPipelined(iterations_count);
+        else
+            runSequentially(iterations_count);
+    }
+
+private:
+    void runSequentially(int iterations_count) {
+        while (m_iteration < iterations_count) {
+            if (m_drawer && m_drawer->wantsToClose())
+                break;
+
             makeSimulationStep();
 
-            writeToLog();
+            m_snapshot.assign(m_world, m_iteration);
+
+            writeToLog(m_snapshot);
+
+            drawWorld(m_snapshot);
 
-            drawWorld();
+            saveScheduledCheckpoint();
         }
     }
 
-    void startSimulationForIterationsCount(int iterations_count) {
-        for (m_iteration = 0; m_iteration < iterations_count;) {
-            if (m_drawer && m_drawer->wantsToClose())
-                break;
+    // the world is never touched by the consumers, so its results do not depend on how fast they are
+    void simulate(int iterations_count) {
+        bool is_logging = !m_loggers.empty();
+        bool is_drawing = m_drawer != nullptr;
 
+        while (m_iteration < iterations_count && !m_is_stopping) {
             makeSimulationStep();
 
+            if (is_logging && m_log_buffer.isAcceptingSnapshot()) {
+                m_log_buffer.getWritingSlot().assign(m_world, m_iteration);
+                m_log_buffer.publish();
+            }
+
+            if (is_drawing && m_render_buffer.isAcceptingSnapshot()) {
+                m_render_buffer.getWritingSlot().assign(m_world, m_iteration);
+                m_render_buffer.publish();
+            }
 
+            saveScheduledCheckpoint();
+        }
+
+        m_log_buffer.close();
+        m_render_buffer.close();
+    }
+
+    // windows have to be used by the thread that created them, so drawing stays on the calling thread
+    void runPipelined(int iterations_count) {
+        m_is_stopping = false;
 
-            writeToLog();
+        m_log_buffer.reopen();
+        m_render_buffer.reopen();
 
-            drawWorld();
+        std::thread physics_thread(&Simulation::simulate, this, iterations_count);
+
+        std::thread log_thread([this]() {
+            while (const WorldSnapshot *snapshot = m_log_buffer.acquire()) {
+                writeToLog(*snapshot);
+            }
+        });
+
+        if (m_drawer) {
+            while (!m_render_buffer.isFinished()) {
+                if (m_drawer->wantsToClose()) {
+                    // closing also releases the world if it waits for the drawer
+                    m_is_stopping = true;
+                    m_render_buffer.close();
+                    break;
+                }
+
+                // about sixty checks a second keep the window responsive while the world is slow
+                if (const WorldSnapshot *snapshot = m_render_buffer.acquireFor(std::chrono::milliseconds(16)))
+                    drawWorld(*snapshot);
+                else
+                    m_drawer->pollEvents();
+            }
         }
+
+        physics_thread.join();
+        log_thread.join();
     }
 };
 
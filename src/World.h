@@ -2,77 +2,175 @@
 #define PHYSICSSIMULATION_WORLD_H
 
 #include "Atom.h"
+#include "ParticleStorage.h"
+#include "Helpers/BlockAverage.h"
+#include "Helpers/CellList.h"
+#include "Helpers/FloatBits.h"
+#include "Helpers/ForceLoopConfig.h"
+#include "Helpers/ForceObservables.h"
 #include "Helpers/Random.h"
+#include "Helpers/ThreadPool.h"
+#include "Helpers/WorkPartition.h"
 #include "Helpers/LennardJones.h"
+#include "Helpers/LennardJonesKernel.h"
+#include "Helpers/NeighbourList.h"
+#include "Helpers/PairPotential.h"
+#include "Helpers/RungeKutta.h"
 #include "Helpers/WorldData.h"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cmath>
+#include <functional>
 #include <iostream>
-#include <thread>
+#include <memory>
+#include <span>
+
+struct PressureTensor {
+    double xx{0.};
+    double yy{0.};
+    double xy{0.};
+
+    // in two dimensions the scalar pressure is half of the trace
+    [[nodiscard]] double getPressure() const {
+        return (xx + yy) / 2.;
+    }
+};
 
 class World {
 public:
     explicit World(const std::function<void(std::vector<Atom> &)> &atoms_generator) {
-        atoms_generator(m_atoms);
+        std::vector<Atom> atoms;
+        atoms_generator(atoms);
+
+        m_atoms.assign(atoms);
     }
 
-    std::vector<Atom> &getAtoms() {
+    // atoms may be changed through the returned reference, so cached forces are dropped
+    ParticleStorage &getAtoms() {
+        m_are_forces_valid = false;
+
         return m_atoms;
     }
 
-    [[nodiscard]] const std::vector<Atom> &getAtoms() const {
+    [[nodiscard]] const ParticleStorage &getAtoms() const {
         return m_atoms;
     }
 
-    [[nodiscard]] double getTotalEnergy() const {
+    [[nodiscard]] double getKineticEnergy() const {
         double totalKineticEnergy = 0;
 
-        for (auto &atom: m_atoms) {
-            totalKineticEnergy += atom.getKineticEnergy();
+        for (int i = 0; i < m_atoms.size(); ++i) {
+            totalKineticEnergy += m_atoms.getKineticEnergy(i);
         }
 
-        double totalPotentialEnergy = 0;
+        return totalKineticEnergy;
+    }
 
-        for (auto first = m_atoms.begin(); first != m_atoms.end(); first++) {
-            for (auto second = first + 1; second != m_atoms.end(); second++) {
-                double distance = std::sqrt(
-                        std::pow(first->position.x - second->position.x, 2) +
-                        std::pow(first->position.y - second->position.y, 2)
-                );
+    // taken from the last force evaluation at the current positions, see updateObservables
+    [[nodiscard]] double getPotentialEnergy() const {
+        return m_are_forces_valid ? m_observables.potential_energy : computePotentialEnergy();
+    }
 
-                auto interaction = m_worldData.getInteraction(first->type, second->type);
-                totalPotentialEnergy += LennardJones::getPotential(distance, interaction);
-            }
-        }
+    [[nodiscard]] double getTotalEnergy() const {
+        return getKineticEnergy() + getPotentialEnergy();
+    }
 
-        return totalKineticEnergy + totalPotentialEnergy;
+    [[nodiscard]] double getVirial() const {
+        return m_are_forces_valid ? m_observables.getVirial() : 0.;
     }
 
-    void makeSimulationStep() {
-        integrate();
+    // evaluates forces at the current positions unless they are already known;
+    // the next step reuses them, so observables cost nothing extra
+    void updateObservables() {
+        if (!m_are_forces_valid)
+            updateForces();
 
-        m_iteration++;
+        samplePressure();
     }
 
-    [[nodiscard]] double getTemperature() const {
-        double totalKineticEnergy = 0;
+    // pressure tensor (sum of m v_a v_b + W_ab) / A at the last sampled state
+    [[nodiscard]] const PressureTensor &getPressureTensor() const {
+        return m_pressure_tensor;
+    }
+
+    // (K + W / 2) / A, does not need walls and is available after every sample
+    [[nodiscard]] double getVirialPressure() const {
+        return m_pressure_tensor.getPressure();
+    }
+
+    // averaged over all sampled states since the last reset, with the block averaging error
+    [[nodiscard]] const BlockAverage &getVirialPressureAverage() const {
+        return m_virial_pressure_average;
+    }
+
+    [[nodiscard]] PressureTensor getAveragePressureTensor() const {
+        long long count = m_virial_pressure_average.getCount();
+
+        if (count == 0)
+            return {};
+
+        return {m_pressure_tensor_sum.xx / (double) count, m_pressure_tensor_sum.yy / (double) count,
+                m_pressure_tensor_sum.xy / (double) count};
+    }
 
-        for (auto &atom: m_atoms) {
-            totalKineticEnergy += atom.getKineticEnergy();
+    void resetVirialPressureAverage() {
+        m_virial_pressure_average.reset();
+        m_pressure_tensor_sum = PressureTensor();
+    }
+
+    void makeSimulationStep() {
+        // buffers are grown only when atoms or threads are added, or when the integrator or the force
+        // accumulation changes, because each of them uses its own buffers
+        bool is_steady = m_buffers_atoms_count >= m_atoms.size() &&
+                         m_buffers_threads_count == m_worldData.getThreadsCount() &&
+                         m_buffers_integrator == m_worldData.getIntegrator() &&
+                         m_buffers_force_accumulation == m_worldData.getEffectiveForceAccumulation();
+
+        m_step_allocations_count = 0;
+        long long pair_buffers_allocations = getPairBuffersAllocationsCount();
+
+        updateTimeDelta();
+
+        switch (m_worldData.getIntegrator()) {
+            case Integrator::RUNGE_KUTTA:
+                integrate(m_dt);
+                break;
+            case Integrator::VELOCITY_VERLET:
+                integrateVelocityVerlet(m_dt);
+                break;
         }
 
-        return totalKineticEnergy / (double) m_atoms.size();
+        finishStep(m_dt);
+
+        m_time += m_dt;
+
+        assert(!is_steady || m_step_allocations_count == 0);
+
+        // pair buffers grow when the system gets denser, not only with atoms, so they are reported but not asserted
+        m_step_allocations_count += std::max(0LL, getPairBuffersAllocationsCount() - pair_buffers_allocations);
+
+        m_buffers_atoms_count = std::max(m_buffers_atoms_count, m_atoms.size());
+        m_buffers_threads_count = m_worldData.getThreadsCount();
+        m_buffers_integrator = m_worldData.getIntegrator();
+        m_buffers_force_accumulation = m_worldData.getEffectiveForceAccumulation();
+
+        m_iteration++;
+    }
+
+    [[nodiscard]] double getTemperature() const {
+        return getKineticEnergy() / (double) m_atoms.getAliveCount();
     }
 
     [[nodiscard]] double getAverageSpeed() const {
         double totalSpeed = 0;
 
-        for (auto &atom: m_atoms) {
-            totalSpeed += atom.getAbsoluteSpeed();
+        for (int i = 0; i < m_atoms.size(); ++i) {
+            totalSpeed += std::sqrt(m_atoms.vx[i] * m_atoms.vx[i] + m_atoms.vy[i] * m_atoms.vy[i]);
         }
 
-        return totalSpeed / (double) m_atoms.size();
+        return totalSpeed / (double) m_atoms.getAliveCount();
     }
 
     [[nodiscard]] double getArea() const {
@@ -82,8 +180,10 @@ public:
     [[nodiscard]] double getDensity() const {
         double totalMass = 0;
 
-        for (auto &atom: m_atoms)
-            totalMass += atom.mass;
+        for (int i = 0; i < m_atoms.size(); ++i) {
+            if (m_atoms.is_alive[i])
+                totalMass += m_atoms.mass[i];
+        }
 
         return totalMass / getArea();
     }
@@ -114,226 +214,996 @@ public:
         return m_moving_wall_mass;
     }
 
+    [[nodiscard]] const NeighbourListStatistics &getNeighbourListStatistics() const {
+        return m_neighbour_list.getStatistics();
+    }
+
+    void resetNeighbourListStatistics() {
+        m_neighbour_list.resetStatistics();
+    }
+
+    [[nodiscard]] ThreadPoolStatistics getThreadPoolStatistics() const {
+        return m_thread_pool ? m_thread_pool->getStatistics() : ThreadPoolStatistics();
+    }
+
+    void resetThreadPoolStatistics() {
+        if (m_thread_pool)
+            m_thread_pool->resetStatistics();
+    }
+
+    // time step of the last made step
+    [[nodiscard]] double getTimeDelta() const {
+        return m_dt;
+    }
+
+    // simulated time since the start
+    [[nodiscard]] double getTime() const {
+        return m_time;
+    }
+
+    // steps at which the adaptive time step changed noticeably
+    [[nodiscard]] const std::vector<TimeDeltaRecord> &getTimeDeltaHistory() const {
+        return m_time_delta_history;
+    }
+
+    // atoms that left the box and were removed since the start
+    [[nodiscard]] long long getLostAtomsCount() const {
+        return m_lost_atoms_count;
+    }
+
+    // drops removed atoms from the storage; their indices are reused, so caches indexed by atoms are renumbered
+    void compactAtoms() {
+        if (m_atoms.getTombstonesCount() == 0)
+            return;
+
+        size_t old_size = m_atoms.size();
+        auto &new_indices = m_atoms.compact();
+
+        if (m_forces.size() == old_size) {
+            for (size_t i = 0; i < old_size; ++i) {
+                if (new_indices[i] >= 0)
+                    m_forces[new_indices[i]] = m_forces[i];
+            }
+
+            m_forces.resize(m_atoms.size());
+        }
+
+        m_neighbour_list.remap(new_indices);
+    }
+
+    [[nodiscard]] long long getStepAllocationsCount() const {
+        return m_step_allocations_count;
+    }
+
     WorldData &getWorldData() {
+        m_are_forces_valid = false;
+
+        return m_worldData;
+    }
+
+    [[nodiscard]] const WorldData &getWorldData() const {
         return m_worldData;
     }
 
+    // everything that the following steps depend on, including cached forces and the neighbour list,
+    // whose order decides the order of summation; the random generator is shared, so it is stored too
+    void writeCheckpoint(BinaryWriter &writer) const {
+        m_worldData.writeCheckpoint(writer);
+        m_atoms.writeCheckpoint(writer);
+        m_neighbour_list.writeCheckpoint(writer);
+
+        writer.writeVector(m_forces);
+        writer.write(m_impulse);
+        writer.write(m_moving_wall_force);
+        writer.write(m_observables);
+        writer.write(m_are_forces_valid);
+
+        writer.write(m_is_pressure_sampled);
+        writer.write(m_pressure_tensor);
+        writer.write(m_pressure_tensor_sum);
+        m_virial_pressure_average.writeCheckpoint(writer);
+
+        writer.write(m_pressure);
+        writer.write(m_total_impulse);
+        writer.write(m_impulse_time);
+        writer.write(m_iteration);
+        writer.write(m_lost_atoms_count);
+
+        writer.write(m_dt);
+        writer.write(m_time);
+        writer.writeVector(m_time_delta_history);
+
+        writer.write(m_moving_wall_y);
+        writer.write(m_moving_wall_speed);
+        writer.write(m_moving_wall_mass);
+
+        writer.writeString(Random::get().getState());
+    }
+
+    // The reader must be checked beforehand (see Checkpoint::openFile), then the only possible failure
+    // is a missing tabulated potential, which is found before the world is changed.
+    void readCheckpoint(BinaryReader &reader) {
+        m_worldData.readCheckpoint(reader);
+
+        if (reader.isFailed())
+            return;
+
+        m_atoms.readCheckpoint(reader);
+        m_neighbour_list.readCheckpoint(reader);
+
+        reader.readVector(m_forces);
+        m_impulse = reader.read<double>();
+        m_moving_wall_force = reader.read<double>();
+        m_observables = reader.read<ForceObservables>();
+        m_are_forces_valid = reader.read<bool>();
+
+        m_is_pressure_sampled = reader.read<bool>();
+        m_pressure_tensor = reader.read<PressureTensor>();
+        m_pressure_tensor_sum = reader.read<PressureTensor>();
+        m_virial_pressure_average.readCheckpoint(reader);
+
+        m_pressure = reader.read<double>();
+        m_total_impulse = reader.read<double>();
+        m_impulse_time = reader.read<double>();
+        m_iteration = reader.read<int>();
+        m_lost_atoms_count = reader.read<long long>();
+
+        m_dt = reader.read<double>();
+        m_time = reader.read<double>();
+        reader.readVector(m_time_delta_history);
+
+        m_moving_wall_y = reader.read<double>();
+        m_moving_wall_speed = reader.read<double>();
+        m_moving_wall_mass = reader.read<double>();
+
+        if (!Random::get().setState(reader.readString()))
+            reader.setFailed();
+
+        // step buffers are regrown for the new atoms; the first step may reuse the restored forces
+        // and skip collecting observables, so their buffer is grown here
+        m_buffers_atoms_count = 0;
+        m_buffers_threads_count = 0;
+
+        reserveBuffer(m_atom_observables, m_atoms.size());
+    }
+
 private:
     WorldData m_worldData;
 
-    std::vector<Atom> m_atoms;
+    ParticleStorage m_atoms;
+
+    // copy of the box from the settings, refreshed before every force evaluation
+    PeriodicBox m_box;
+
+    CellList m_cell_list;
+    NeighbourList m_neighbour_list;
+
+    std::unique_ptr<ThreadPool> m_thread_pool;
+    WorkPartition m_work_partition;
+    // private force buffers of the threads, used when forces of a pair are applied to both atoms;
+    // they are kept zero outside the ranges written during the current evaluation
+    std::vector<std::vector<sf::Vector2d>> m_thread_forces;
+
+    // atoms [begin, end) whose forces a thread wrote into its private buffer
+    struct alignas(64) ForceRange {
+        int begin{0};
+        int end{0};
+
+        void include(int begin_index, int end_index) {
+            if (begin == end) {
+                begin = begin_index;
+                end = end_index;
+            } else {
+                begin = std::min(begin, begin_index);
+                end = std::max(end, end_index);
+            }
+        }
+    };
+
+    std::vector<ForceRange> m_thread_force_ranges;
+    // scratch space of the threads for the vectorized kernel
+    std::vector<PairBatch> m_thread_batches;
+    // wall contributions and observables of every atom, summed after all threads are done
+    std::vector<double> m_atom_impulses;
+    std::vector<double> m_atom_moving_wall_forces;
+    std::vector<ForceObservables> m_atom_observables;
+
+    RungeKutta<sf::Vector2d> m_runge_kutta;
+    std::vector<sf::Vector2d> m_state;
+
+    // forces for the current positions, kept between steps by velocity Verlet
+    std::vector<sf::Vector2d> m_forces;
+    double m_impulse{0.};
+    double m_moving_wall_force{0.};
+    ForceObservables m_observables;
+    bool m_are_forces_valid{false};
+
+    // every state is sampled once, when both forces and speeds belong to it
+    bool m_is_pressure_sampled{false};
+    PressureTensor m_pressure_tensor;
+    PressureTensor m_pressure_tensor_sum;
+    BlockAverage m_virial_pressure_average;
+
+    // reallocations of the step buffers, the neighbour structures and the kernel batches during the last step,
+    // zero once their sizes settle
+    long long m_step_allocations_count{0};
+    size_t m_buffers_atoms_count{0};
+    unsigned int m_buffers_threads_count{0};
+    Integrator m_buffers_integrator{Integrator::RUNGE_KUTTA};
+    ForceAccumulation m_buffers_force_accumulation{ForceAccumulation::AUTOMATIC};
 
     double m_pressure{0.};
     double m_total_impulse{0.};
+    // time over which m_total_impulse was accumulated
+    double m_impulse_time{0.};
 
     int m_iteration{0};
 
+    long long m_lost_atoms_count{0};
+    // removed atoms are compacted once they make up this part of the storage
+    static constexpr size_t MAX_TOMBSTONES_FRACTION_INVERSE = 16;
+
+    double m_dt{0.};
+    double m_time{0.};
+    std::vector<TimeDeltaRecord> m_time_delta_history;
+
     double m_moving_wall_y{0};
     double m_moving_wall_speed{0};
     double m_moving_wall_mass{10.};
 
-    void getForcesForInterval(sf::Vector2d *forces, double *impulse, double *moving_wall_force, int begin_index,
-                              int end_index) {
-        sf::Vector2d f;
+    static constexpr double GRAVITY = 0.5;
+
+    // reallocations inside the cell list, the neighbour list and the kernel batches
+    [[nodiscard]] long long getPairBuffersAllocationsCount() const {
+        long long count = m_cell_list.getAllocationsCount() + m_neighbour_list.getAllocationsCount();
+
+        for (auto &batch: m_thread_batches) {
+            count += batch.allocations_count;
+        }
+
+        return count;
+    }
+
+    // resizes a buffer that lives across steps, counting every reallocation
+    template<class T>
+    void reserveBuffer(std::vector<T> &buffer, size_t size) {
+        if (size > buffer.capacity())
+            m_step_allocations_count++;
+
+        buffer.resize(size);
+    }
+
+    // calls callback(j) for every atom j that may interact with atom i;
+    // half neighbours contain only atoms with j > i, so every pair is visited once
+    template<class Callback>
+    void forEachNeighbour(int i, bool is_full, Callback &&callback) const {
+        if (m_worldData.isUsingNeighbourList()) {
+            m_neighbour_list.forEachNeighbour(i, callback);
+        } else if (m_worldData.isUsingCellList()) {
+            m_cell_list.forEachNeighbour(i, is_full, callback);
+        } else {
+            for (int j = is_full ? 0 : i + 1; j < m_atoms.size(); j++) {
+                if (j != i && m_atoms.is_alive[j])
+                    callback(j);
+            }
+        }
+    }
+
+    // End of the atoms that half pairs of atoms [begin_index, end_index) can reach, their partners have
+    // greater indices. Atoms close in space are usually close in the storage, so the range stays short.
+    [[nodiscard]] int getPartnersEnd(int begin_index, int end_index) const {
+        if (!m_worldData.isUsingNeighbourList() && !m_worldData.isUsingCellList())
+            return (int) m_atoms.size();
+
+        int partners_end = end_index;
+
+        for (int i = begin_index; i < end_index; ++i) {
+            if (!m_atoms.is_alive[i])
+                continue;
+
+            int max_neighbour = m_worldData.isUsingNeighbourList() ? m_neighbour_list.getMaxNeighbour(i)
+                                                                   : m_cell_list.getMaxNeighbour(i);
+
+            partners_end = std::max(partners_end, max_neighbour + 1);
+        }
+
+        return partners_end;
+    }
+
+    // adds the pair potential and virial to observables when they are requested
+    template<class Config>
+    [[nodiscard]] sf::Vector2d getPairForce(int i, int j, ForceObservables *observables) const {
+        auto &interaction = m_worldData.getInteraction(m_atoms.type[i], m_atoms.type[j]);
+
+        double dx = m_atoms.x[i] - m_atoms.x[j];
+        double dy = m_atoms.y[i] - m_atoms.y[j];
+
+        if constexpr (Config::IS_PERIODIC)
+            m_box.applyMinimumImage(dx, dy);
+
+        if (abs(dx) > interaction.CUTOFF)
+            return {};
+        if (abs(dy) > interaction.CUTOFF)
+            return {};
+
+        double distance_sqr = dx * dx + dy * dy;
+        double force = PairPotential::getForce(distance_sqr, interaction);
+
+        if (observables) {
+            observables->potential_energy += PairPotential::getShiftedPotential(distance_sqr, interaction);
+            observables->addPairVirial(dx, dy, force);
+        }
+
+        return force * sf::Vector2d(dx, dy);
+    }
+
+    // appends pairs of atom i to the batch
+    template<class Config>
+    void gatherPairs(int i, bool is_full, PairBatch &batch) const {
+        // neighbours mostly share the type, so the interaction is looked up only when it changes
+        AtomType last_type = m_atoms.type[i];
+        const InteractionInfo *interaction = &m_worldData.getInteraction(m_atoms.type[i], last_type);
+
+        double x = m_atoms.x[i];
+        double y = m_atoms.y[i];
+
+        auto is_same_as_uniform = [&]() {
+            return interaction->COEFF == batch.uniform_coeff &&
+                   interaction->SIGMA_SIXTH_POWER == batch.uniform_sigma_sixth_power &&
+                   interaction->CUTOFF_SQR == batch.uniform_cutoff_sqr;
+        };
+
+        if (batch.size == 0)
+            batch.setUniformParameters(interaction->SIGMA_SIXTH_POWER, interaction->COEFF, interaction->CUTOFF_SQR);
+        else if (batch.is_uniform && !is_same_as_uniform())
+            batch.makeNonUniform();
+
+        forEachNeighbour(i, is_full, [&](int j) {
+            if (batch.size == batch.neighbours.size())
+                batch.reserve(2 * batch.size + 16);
+
+            if (m_atoms.type[j] != last_type) {
+                last_type = m_atoms.type[j];
+                interaction = &m_worldData.getInteraction(m_atoms.type[i], last_type);
+
+                if (batch.is_uniform && !is_same_as_uniform())
+                    batch.makeNonUniform();
+            }
+
+            double dx = x - m_atoms.x[j];
+            double dy = y - m_atoms.y[j];
+
+            if constexpr (Config::IS_PERIODIC)
+                m_box.applyMinimumImage(dx, dy);
+
+            double distance_sqr = dx * dx + dy * dy;
+
+            // scattering zero forces costs more than the branch
+            if (distance_sqr >= interaction->CUTOFF_SQR)
+                return;
+
+            size_t k = batch.size++;
+
+            batch.atoms[k] = i;
+            batch.neighbours[k] = j;
+            batch.dx[k] = dx;
+            batch.dy[k] = dy;
+            batch.distance_sqr[k] = distance_sqr;
+
+            if (!batch.is_uniform) {
+                batch.sigma_sixth_power[k] = interaction->SIGMA_SIXTH_POWER;
+                batch.coeff[k] = interaction->COEFF;
+                batch.cutoff_sqr[k] = interaction->CUTOFF_SQR;
+            }
+        });
+    }
+
+    // Pairs of consecutive atoms are collected into one batch, because single atoms
+    // have too few neighbours to fill the vector registers.
+    template<class Config>
+    void getPairForcesBatched(sf::Vector2d *forces, bool is_owner_computes, bool is_computing_observables,
+                              unsigned int thread_index, int begin_index, int end_index) {
+        const size_t batch_size = 512;
+
+        auto &batch = m_thread_batches[thread_index];
+
+        if (is_owner_computes)
+            std::fill(forces + begin_index, forces + end_index, sf::Vector2d());
+
+        // owner computes visits every pair twice
+        double pair_share = is_owner_computes ? 0.5 : 1.;
+
+        for (int i = begin_index; i < end_index;) {
+            batch.clear();
+
+            for (; i < end_index && batch.size < batch_size; i++) {
+                if (m_atoms.is_alive[i])
+                    gatherPairs<Config>(i, is_owner_computes, batch);
+            }
+
+            LennardJonesKernel::compute(batch);
+
+            for (size_t k = 0; k < batch.size; ++k) {
+                sf::Vector2d f = batch.force[k] * sf::Vector2d(batch.dx[k], batch.dy[k]);
+
+                forces[batch.atoms[k]] += f;
+
+                if (!is_owner_computes)
+                    forces[batch.neighbours[k]] -= f;
+
+                if (is_computing_observables) {
+                    auto &interaction = m_worldData.getInteraction(m_atoms.type[batch.atoms[k]],
+                                                                   m_atoms.type[batch.neighbours[k]]);
+                    auto &observables = m_atom_observables[batch.atoms[k]];
+
+                    observables.potential_energy +=
+                            pair_share * PairPotential::getShiftedPotential(batch.distance_sqr[k], interaction);
+                    observables.addPairVirial(batch.dx[k], batch.dy[k], pair_share * batch.force[k]);
+                }
+            }
+        }
+    }
+
+    // With owner computes every thread writes only forces of atoms from its own interval,
+    // otherwise forces points to the private buffer of the thread and pairs are visited once.
+    template<class Config>
+    void getForcesForInterval(sf::Vector2d *forces, bool is_owner_computes, bool is_computing_observables,
+                              unsigned int thread_index, int begin_index, int end_index) {
+        if (is_computing_observables)
+            std::fill(m_atom_observables.begin() + begin_index, m_atom_observables.begin() + end_index,
+                      ForceObservables());
+
+        // the interval itself and every partner of its pairs are written into the private buffer
+        if (!is_owner_computes)
+            m_thread_force_ranges[thread_index].include(begin_index, getPartnersEnd(begin_index, end_index));
+
+        // the vectorized kernel knows only the built-in Lennard-Jones
+        bool is_batched = m_worldData.isUsingSimdKernel() && !m_worldData.hasTabulatedPotentials();
+
+        if (is_batched)
+            getPairForcesBatched<Config>(forces, is_owner_computes, is_computing_observables, thread_index,
+                                         begin_index, end_index);
+
+        double box_width = m_worldData.getBoxSize().x;
+        double box_height = getBoxHeight();
+        double moving_wall_weight = GRAVITY * m_moving_wall_mass;
 
         for (int i = begin_index; i < end_index; i++) {
-            // atom - atom forces
-            for (int j = i + 1; j < m_atoms.size(); j++) {
-                auto interaction = m_worldData.getInteraction(m_atoms[i].type, m_atoms[j].type);
+            ForceObservables atom_observables;
+            ForceObservables *observables = is_computing_observables ? &atom_observables : nullptr;
 
-                if (abs(m_atoms[i].position.x - m_atoms[j].position.x) > 2.5 * interaction.SIGMA)
-                    continue;
-                if (abs(m_atoms[i].position.y - m_atoms[j].position.y) > 2.5 * interaction.SIGMA)
-                    continue;
+            // removed atoms keep their index until compaction, but feel no forces
+            if (!m_atoms.is_alive[i]) {
+                if (is_owner_computes)
+                    forces[i] = sf::Vector2d();
 
-                double distance_sqr = std::pow(m_atoms[i].position.x - m_atoms[j].position.x, 2) +
-                                      std::pow(m_atoms[i].position.y - m_atoms[j].position.y, 2);
+                m_atom_impulses[i] = 0;
+                m_atom_moving_wall_forces[i] = 0;
 
-                f = LennardJones::getForce(distance_sqr, interaction) * (m_atoms[i].position - m_atoms[j].position);
+                continue;
+            }
 
-                forces[i] += f;
-                forces[j] -= f;
+            // atom - atom forces
+            if (is_batched) {
+                // already computed in batches
+            } else if (is_owner_computes) {
+                sf::Vector2d force;
+
+                forEachNeighbour(i, true, [&](int j) {
+                    force += getPairForce<Config>(i, j, observables);
+                });
+
+                forces[i] = force;
+
+                // owner computes visits every pair twice
+                atom_observables *= 0.5;
+            } else {
+                forEachNeighbour(i, false, [&](int j) {
+                    sf::Vector2d f = getPairForce<Config>(i, j, observables);
+
+                    forces[i] += f;
+                    forces[j] -= f;
+                });
             }
 
             // atom - wall forces
+            double impulse = 0;
+            double moving_wall_force = 0;
 
-            if (m_worldData.isCollidingWithWalls()) {
+            double left = m_atoms.x[i];
+            double top = m_atoms.y[i];
+            double right = box_width - m_atoms.x[i];
+            double bottom = box_height - m_atoms.y[i];
+
+            // most atoms are further than the wall cutoff from every wall
+            bool is_near_wall = Config::IS_COLLIDING_WITH_WALLS &&
+                                std::min(std::min(left, right), std::min(top, bottom)) <
+                                m_worldData.getInteraction(m_atoms.type[i], AtomType::WALL).WALL_CUTOFF;
+
+            if (is_near_wall) {
                 double wf;
-                auto &wall_interaction = m_worldData.getInteraction(m_atoms[i].type, AtomType::WALL);
+                auto &wall_interaction = m_worldData.getInteraction(m_atoms.type[i], AtomType::WALL);
 
                 // left wall
-                wf = LennardJones::getWallForce(m_atoms[i].position.x, wall_interaction);
+                wf = LennardJones::getWallForce(left, wall_interaction);
                 forces[i].x += wf;
-                *impulse += wf;
+                impulse += wf;
 
                 // top wall
-                wf = LennardJones::getWallForce(m_atoms[i].position.y, wall_interaction);
+                wf = LennardJones::getWallForce(top, wall_interaction);
                 forces[i].y += wf;
-                *impulse += wf;
+                impulse += wf;
 
                 // right wall
-                wf = LennardJones::getWallForce(m_worldData.getBoxSize().x - m_atoms[i].position.x, wall_interaction);
+                wf = LennardJones::getWallForce(right, wall_interaction);
                 forces[i].x -= wf;
-                *impulse += wf;
+                impulse += wf;
 
                 // bottom wall
-                wf = LennardJones::getWallForce(getBoxHeight() - m_atoms[i].position.y, wall_interaction);
+                wf = LennardJones::getWallForce(bottom, wall_interaction);
                 forces[i].y -= wf;
-                *impulse += wf;
-                *moving_wall_force += wf;
+                impulse += wf;
+                moving_wall_force += wf;
+
+                if (observables) {
+                    for (double distance: {left, top, right, bottom}) {
+                        atom_observables.potential_energy += LennardJones::getWallPotential(distance, wall_interaction);
+                    }
+                }
             }
 
             // gravitation
-            if (m_worldData.isGravityEnabled()) {
-                double gravity = 0.5;
+            if constexpr (Config::IS_GRAVITY_ENABLED) {
+                forces[i].y -= GRAVITY * m_atoms.mass[i];
+                moving_wall_force -= moving_wall_weight;
 
-                forces[i].y -= gravity * m_atoms[i].mass;
-                *moving_wall_force -= gravity * m_moving_wall_mass;
+                atom_observables.potential_energy += GRAVITY * m_atoms.mass[i] * m_atoms.y[i];
             }
+
+            m_atom_impulses[i] = impulse;
+            m_atom_moving_wall_forces[i] = moving_wall_force;
+
+            if (is_computing_observables)
+                m_atom_observables[i] += atom_observables;
         }
     }
 
-    void getForces(sf::Vector2d *forces, double *impulse, double *moving_wall_force) {
-        std::vector<std::thread> threads;
+    [[nodiscard]] std::pair<int, int> getThreadInterval(unsigned int thread_index, unsigned int threads_count) const {
+        int count_per_thread = (int) (m_atoms.size() / threads_count);
+
+        return {
+                count_per_thread * (int) thread_index,
+                (thread_index == threads_count - 1) ? (int) m_atoms.size() : count_per_thread * (int) (thread_index + 1)
+        };
+    }
+
+    // estimated cost of the force loop for atom i measured in visited pairs
+    [[nodiscard]] double getAtomCost(int i, bool is_full) const {
+        // walls and gravity cost about as much as a few pairs
+        const double atom_cost = 4;
+
+        if (m_worldData.isUsingNeighbourList())
+            return atom_cost + m_neighbour_list.getNeighboursCount(i);
+
+        if (m_worldData.isUsingCellList())
+            return atom_cost + m_cell_list.getNeighbourhoodSize(i);
+
+        return atom_cost + (double) (is_full ? m_atoms.size() : m_atoms.size() - i - 1);
+    }
+
+    void schedulePairWork(bool is_full, unsigned int threads_count) {
+        switch (m_worldData.getWorkScheduling()) {
+            case WorkScheduling::EQUAL:
+                m_work_partition.buildEqual((int) m_atoms.size(), threads_count);
+                break;
+            case WorkScheduling::COST_WEIGHTED:
+                m_work_partition.build((int) m_atoms.size(), threads_count, [&](int i) {
+                    return getAtomCost(i, is_full);
+                });
+                break;
+            case WorkScheduling::DYNAMIC_CHUNKS:
+                m_work_partition.buildChunks((int) m_atoms.size(), threads_count);
+                break;
+        }
+    }
 
-        unsigned int threads_count = std::thread::hardware_concurrency();
-        int count_per_thread = std::floor(m_atoms.size() / threads_count);
+    template<class Config>
+    void getForcesForScheduledWork(sf::Vector2d *forces, bool is_owner_computes, bool is_computing_observables,
+                                   unsigned int thread_index) {
+        if (m_worldData.getWorkScheduling() != WorkScheduling::DYNAMIC_CHUNKS) {
+            auto [begin, end] = m_work_partition.getInterval(thread_index);
 
-        threads.reserve(threads_count);
-        for (int i = 0; i < threads_count; i++) {
-            threads.emplace_back(
-                    &World::getForcesForInterval, this, forces, impulse, moving_wall_force,
-                    count_per_thread * i,
-                    (i == threads_count - 1) ? m_atoms.size() : count_per_thread * (i + 1)
-            );
+            getForcesForInterval<Config>(forces, is_owner_computes, is_computing_observables, thread_index, begin,
+                                         end);
+            return;
         }
 
-        for (auto &th: threads) {
-            th.join();
+        while (true) {
+            auto [begin, end] = m_work_partition.takeChunk();
+
+            if (begin >= end)
+                break;
+
+            getForcesForInterval<Config>(forces, is_owner_computes, is_computing_observables, thread_index, begin,
+                                         end);
         }
     }
 
-    void integrate() {
-        double dt = m_worldData.getTimeDelta();
+    // observables are collected only when they are requested, that is for the real state and not for the stages
+    void getForces(sf::Vector2d *forces, double *impulse, double *moving_wall_force,
+                   ForceObservables *observables = nullptr) {
+        bool is_computing_observables = observables != nullptr;
+        m_box = m_worldData.getPeriodicBox();
+
+        bool is_owner_computes = m_worldData.getEffectiveForceAccumulation() == ForceAccumulation::OWNER_COMPUTES;
+
+        if (m_worldData.isUsingNeighbourList()) {
+            updateNeighbourList(is_owner_computes);
+        } else if (m_worldData.isUsingCellList()) {
+            m_cell_list.build(m_atoms, m_worldData.getMaxCutoff(), m_box);
+        }
 
-        auto k1 = new sf::Vector2d[m_atoms.size()];
-        auto k2 = new sf::Vector2d[m_atoms.size()];
-        auto k3 = new sf::Vector2d[m_atoms.size()];
-        auto k4 = new sf::Vector2d[m_atoms.size()];
+        if (!m_thread_pool || m_thread_pool->getThreadsCount() != m_worldData.getThreadsCount())
+            m_thread_pool = std::make_unique<ThreadPool>(m_worldData.getThreadsCount());
 
-        auto m1 = new sf::Vector2d[m_atoms.size()];
-        auto m2 = new sf::Vector2d[m_atoms.size()];
-        auto m3 = new sf::Vector2d[m_atoms.size()];
-        auto m4 = new sf::Vector2d[m_atoms.size()];
+        unsigned int threads_count = m_thread_pool->getThreadsCount();
 
-        double impulse1 = 0, impulse2 = 0, impulse3 = 0, impulse4 = 0;
+        m_thread_batches.resize(threads_count);
 
-        double mw11 = 0, mw12 = 0, mw13 = 0, mw14 = 0;
-        double mw21 = 0, mw22 = 0, mw23 = 0, mw24 = 0;
+        m_thread_force_ranges.resize(threads_count);
+        std::fill(m_thread_force_ranges.begin(), m_thread_force_ranges.end(), ForceRange());
 
-        // calculate k1
-        getForces(k1, &impulse1, &mw11);
+        reserveBuffer(m_atom_impulses, m_atoms.size());
+        reserveBuffer(m_atom_moving_wall_forces, m_atoms.size());
+
+        if (is_computing_observables)
+            reserveBuffer(m_atom_observables, m_atoms.size());
+
+        schedulePairWork(is_owner_computes, threads_count);
+
+        // the settings are checked here once, the loops of the threads are specialized for them
+        ForceLoopDispatcher::dispatch(m_worldData, [&](auto config) {
+            using Config = decltype(config);
+
+            if (is_owner_computes) {
+                m_thread_pool->run([&](unsigned int thread_index) {
+                    getForcesForScheduledWork<Config>(forces, true, is_computing_observables, thread_index);
+                });
+
+                return;
+            }
+
+            reserveBuffer(m_thread_forces, threads_count);
+
+            for (auto &thread_forces: m_thread_forces) {
+                reserveBuffer(thread_forces, m_atoms.size());
+            }
+
+            // the buffers are already zero, every thread writes only a range around its own atoms
+            m_thread_pool->run([&](unsigned int thread_index) {
+                getForcesForScheduledWork<Config>(m_thread_forces[thread_index].data(), false,
+                                                  is_computing_observables, thread_index);
+            });
+
+            // Every thread sums its own range of atoms over the written parts of the buffers in the fixed order
+            // and clears them for the next evaluation. Buffers that were not written hold zeros, so the sums
+            // are the same as over all buffers, but the work does not grow with the number of threads.
+            m_thread_pool->run([&](unsigned int thread_index) {
+                auto [begin, end] = getThreadInterval(thread_index, threads_count);
+
+                std::fill(forces + begin, forces + end, sf::Vector2d());
+
+                for (unsigned int thread = 0; thread < threads_count; ++thread) {
+                    auto &thread_forces = m_thread_forces[thread];
+                    auto &range = m_thread_force_ranges[thread];
+
+                    for (int i = std::max(begin, range.begin); i < std::min(end, range.end); ++i) {
+                        forces[i] += thread_forces[i];
+                        thread_forces[i] = sf::Vector2d();
+                    }
+                }
+            });
+        });
+
+        // summed in the order of atoms, so the result does not depend on the number of threads
+        *impulse = 0;
+        *moving_wall_force = 0;
 
         for (int i = 0; i < m_atoms.size(); ++i) {
-            k1[i] *= dt / m_atoms[i].mass;
-            m1[i] = m_atoms[i].speed * dt;
+            *impulse += m_atom_impulses[i];
+            *moving_wall_force += m_atom_moving_wall_forces[i];
+        }
+
+        if (is_computing_observables) {
+            *observables = ForceObservables();
+
+            for (int i = 0; i < m_atoms.size(); ++i) {
+                *observables += m_atom_observables[i];
+            }
         }
+    }
 
-        impulse1 *= dt;
-        mw11 *= dt / m_moving_wall_mass;
-        mw21 = m_moving_wall_speed * dt;
+    void updateNeighbourList(bool is_full) {
+        double skin = m_worldData.getNeighbourListSkin();
 
+        if (m_neighbour_list.isFull() != is_full ||
+            m_neighbour_list.needsRebuild(m_atoms, skin, m_worldData.getNeighbourListRebuildPolicy(), m_box)) {
+            double radius = m_worldData.getMaxCutoff() + skin;
 
-        // calculate k2
-        for (int i = 0; i < m_atoms.size(); ++i) {
-            m_atoms[i].position += m1[i] / 2.;
+            m_cell_list.build(m_atoms, radius, m_box);
+            m_neighbour_list.build(m_atoms, m_cell_list, radius, is_full, m_box);
         }
 
-        getForces(k2, &impulse2, &mw12);
+        m_neighbour_list.registerEvaluation();
+    }
 
-        for (int i = 0; i < m_atoms.size(); ++i) {
-            k2[i] *= dt / m_atoms[i].mass;
-            m2[i] = (m_atoms[i].speed + k1[i] / 2.) * dt;
+    void updateTimeDelta() {
+        // relative change of the step that is written into the history
+        const double history_threshold = 0.1;
+
+        double previous_dt = m_dt == 0 ? m_worldData.getTimeDelta() : m_dt;
+
+        if (!m_worldData.isUsingAdaptiveTimeDelta()) {
+            m_dt = m_worldData.getTimeDelta();
+        } else {
+            // forces left by the previous step are exact for velocity Verlet and
+            // belong to the last stage for Runge-Kutta, which is close enough for an estimate
+            if (!m_are_forces_valid && (m_dt == 0 || m_forces.size() != m_atoms.size()))
+                updateForces();
+
+            double max_speed_sqr = 0;
+            double max_acceleration_sqr = 0;
+
+            for (size_t i = 0; i < m_atoms.size(); ++i) {
+                sf::Vector2d acceleration = m_forces[i] / m_atoms.mass[i];
+
+                max_speed_sqr = std::max(max_speed_sqr, m_atoms.vx[i] * m_atoms.vx[i] + m_atoms.vy[i] * m_atoms.vy[i]);
+                max_acceleration_sqr = std::max(max_acceleration_sqr,
+                                                acceleration.x * acceleration.x + acceleration.y * acceleration.y);
+            }
+
+            double max_speed = std::sqrt(max_speed_sqr);
+
+            if (m_worldData.isCollidingWithMovingWall())
+                max_speed = std::max(max_speed, std::abs(m_moving_wall_speed));
+
+            m_dt = m_worldData.getTimeStepController().getTimeDelta(previous_dt, max_speed,
+                                                                    std::sqrt(max_acceleration_sqr));
         }
 
-        impulse2 *= dt;
-        mw12 *= dt / m_moving_wall_mass;
-        mw22 = (m_moving_wall_speed + mw11 / 2.) * dt;
+        if (m_time_delta_history.empty() ||
+            std::abs(m_dt - m_time_delta_history.back().dt) > history_threshold * m_time_delta_history.back().dt)
+            m_time_delta_history.push_back({m_iteration, m_time, m_dt});
+    }
 
-        // calculate k3
-        for (int i = 0; i < m_atoms.size(); ++i) {
-            m_atoms[i].position -= m1[i] / 2.;
-            m_atoms[i].position += m2[i] / 2.;
+    // state of the integrator: positions, speeds, moving wall {y, speed} and accumulated {impulse, 0}
+    void integrate(double dt) {
+        size_t atoms_count = m_atoms.size();
+
+        reserveBuffer(m_state, 2 * atoms_count + 2);
+
+        for (size_t i = 0; i < atoms_count; ++i) {
+            m_state[i] = m_atoms.getPosition(i);
+            m_state[atoms_count + i] = m_atoms.getSpeed(i);
         }
 
-        getForces(k3, &impulse3, &mw13);
+        m_state[2 * atoms_count] = {m_moving_wall_y, m_moving_wall_speed};
+        m_state[2 * atoms_count + 1] = {};
 
-        for (int i = 0; i < m_atoms.size(); ++i) {
-            k3[i] *= dt / m_atoms[i].mass;
-            m3[i] = (m_atoms[i].speed + k2[i] / 2.) * dt;
+        long long integrator_allocations = m_runge_kutta.getAllocationsCount();
+
+        // the first stage is evaluated at the current state, so forces from updateObservables are reused
+        if (!m_are_forces_valid)
+            updateForces();
+
+        samplePressure();
+
+        bool is_first_stage = true;
+
+        m_runge_kutta.integrate(m_state, [&](std::span<const sf::Vector2d> state, std::span<sf::Vector2d> derivative) {
+            double impulse = m_impulse;
+            double moving_wall_force = m_moving_wall_force;
+
+            if (!is_first_stage) {
+                for (size_t i = 0; i < atoms_count; ++i) {
+                    m_atoms.x[i] = state[i].x;
+                    m_atoms.y[i] = state[i].y;
+                }
+
+                m_moving_wall_y = state[2 * atoms_count].x;
+
+                getForces(m_forces.data(), &impulse, &moving_wall_force);
+            }
+
+            is_first_stage = false;
+
+            for (size_t i = 0; i < atoms_count; ++i) {
+                derivative[i] = state[atoms_count + i];
+                derivative[atoms_count + i] = m_forces[i] / m_atoms.mass[i];
+            }
+
+            derivative[2 * atoms_count] = {state[2 * atoms_count].y, moving_wall_force / m_moving_wall_mass};
+            derivative[2 * atoms_count + 1] = {impulse, 0.};
+        }, dt);
+
+        m_step_allocations_count += m_runge_kutta.getAllocationsCount() - integrator_allocations;
+
+        for (size_t i = 0; i < atoms_count; ++i) {
+            m_atoms.x[i] = m_state[i].x;
+            m_atoms.y[i] = m_state[i].y;
+            m_atoms.vx[i] = m_state[atoms_count + i].x;
+            m_atoms.vy[i] = m_state[atoms_count + i].y;
         }
 
-        impulse3 *= dt;
-        mw13 *= dt / m_moving_wall_mass;
-        mw23 = (m_moving_wall_speed + mw12 / 2.) * dt;
+        m_moving_wall_y = m_state[2 * atoms_count].x;
+        m_moving_wall_speed = m_state[2 * atoms_count].y;
 
-        // calculate k4
-        for (int i = 0; i < m_atoms.size(); ++i) {
-            m_atoms[i].position -= m2[i] / 2.;
-            m_atoms[i].position += m3[i];
+        m_total_impulse += m_state[2 * atoms_count + 1].x;
+
+        // the last stage was evaluated at intermediate positions
+        m_are_forces_valid = false;
+    }
+
+    void updateForces() {
+        reserveBuffer(m_forces, m_atoms.size());
+
+        getForces(m_forces.data(), &m_impulse, &m_moving_wall_force, &m_observables);
+
+        m_are_forces_valid = true;
+        m_is_pressure_sampled = false;
+    }
+
+    void samplePressure() {
+        if (!m_are_forces_valid || m_is_pressure_sampled || m_atoms.empty())
+            return;
+
+        PressureTensor kinetic;
+
+        for (size_t i = 0; i < m_atoms.size(); ++i) {
+            kinetic.xx += m_atoms.mass[i] * m_atoms.vx[i] * m_atoms.vx[i];
+            kinetic.yy += m_atoms.mass[i] * m_atoms.vy[i] * m_atoms.vy[i];
+            kinetic.xy += m_atoms.mass[i] * m_atoms.vx[i] * m_atoms.vy[i];
         }
 
-        getForces(k4, &impulse4, &mw14);
+        double area = getArea();
 
-        for (int i = 0; i < m_atoms.size(); ++i) {
-            k4[i] *= dt / m_atoms[i].mass;
-            m4[i] = (m_atoms[i].speed + k3[i]) * dt;
+        m_pressure_tensor = {
+                (kinetic.xx + m_observables.virial_xx) / area,
+                (kinetic.yy + m_observables.virial_yy) / area,
+                (kinetic.xy + m_observables.virial_xy) / area
+        };
+
+        m_pressure_tensor_sum.xx += m_pressure_tensor.xx;
+        m_pressure_tensor_sum.yy += m_pressure_tensor.yy;
+        m_pressure_tensor_sum.xy += m_pressure_tensor.xy;
+
+        m_virial_pressure_average.add(m_pressure_tensor.getPressure());
+
+        m_is_pressure_sampled = true;
+    }
+
+    void kick(double dt) {
+        for (size_t i = 0; i < m_atoms.size(); ++i) {
+            m_atoms.addSpeed(i, m_forces[i] * (dt / m_atoms.mass[i]));
         }
 
-        impulse4 *= dt;
-        mw14 *= dt / m_moving_wall_mass;
-        mw24 = (m_moving_wall_speed + mw13) * dt;
+        m_moving_wall_speed += m_moving_wall_force / m_moving_wall_mass * dt;
+    }
+
+    void integrateVelocityVerlet(double dt) {
+        if (!m_are_forces_valid)
+            updateForces();
 
-        // calculate final positions
-        for (int i = 0; i < m_atoms.size(); ++i) {
-            m_atoms[i].position -= m3[i];
+        double start_impulse = m_impulse;
 
-            m_atoms[i].position += 1. / 6. * (m1[i] + 2. * m2[i] + 2. * m3[i] + m4[i]);
-            m_atoms[i].speed += 1. / 6. * (k1[i] + 2. * k2[i] + 2. * k3[i] + k4[i]);
+        kick(dt / 2.);
+
+        for (size_t i = 0; i < m_atoms.size(); ++i) {
+            m_atoms.movePosition(i, m_atoms.getSpeed(i) * dt);
         }
 
-        m_total_impulse += 1. / 6. * (impulse1 + 2. * impulse2 + 2. * impulse3 + impulse4);
+        m_moving_wall_y += m_moving_wall_speed * dt;
+
+        updateForces();
+
+        kick(dt / 2.);
+
+        samplePressure();
+
+        // trapezoidal rule, consistent with the forces used for the kicks
+        m_total_impulse += (start_impulse + m_impulse) / 2. * dt;
+    }
+
+    // pressure measurement and removal of escaped atoms, common for all integrators
+    void finishStep(double dt) {
+        m_impulse_time += dt;
+
+        // forces do not change, because only the images of the atoms are switched
+        if (m_worldData.isPeriodic()) {
+            PeriodicBox box = m_worldData.getPeriodicBox();
+
+            for (size_t i = 0; i < m_atoms.size(); ++i) {
+                box.wrapPosition(m_atoms.x[i], m_atoms.y[i]);
+            }
+        }
 
+        // the step may vary, so the impulse is divided by the time it was actually collected over
         if (m_iteration % m_worldData.getIterationsPerImpulseMeasurements() == 0) {
-            m_pressure = m_total_impulse / (dt * m_worldData.getIterationsPerImpulseMeasurements()) / getPerimeter();
+            m_pressure = m_total_impulse / m_impulse_time / getPerimeter();
             m_total_impulse = 0;
+            m_impulse_time = 0;
         }
 
-        m_moving_wall_y += 1. / 6. * (mw11 + 2. * mw12 + 2. * mw13 + mw14);
-        m_moving_wall_speed += 1. / 6. * (mw21 + 2. * mw22 + 2. * mw23 + mw24);
-
         if (m_worldData.isCollidingWithWalls()) {
-            std::erase_if(m_atoms, [&](const Atom &atom) -> bool {
-                return isOutside(atom);
-            });
+            bool is_any_lost = false;
+
+            for (int i = 0; i < m_atoms.size(); ++i) {
+                if (m_atoms.is_alive[i] && isOutside(i)) {
+                    m_atoms.remove(i);
+                    m_lost_atoms_count++;
+
+                    is_any_lost = true;
+                }
+            }
+
+            // indices stay the same, but the lost atoms must stop interacting
+            if (is_any_lost) {
+                m_are_forces_valid = false;
+                m_neighbour_list.invalidate();
+            }
         }
 
-        delete[] m1;
-        delete[] m2;
-        delete[] m3;
-        delete[] m4;
+        if (m_atoms.getTombstonesCount() * MAX_TOMBSTONES_FRACTION_INVERSE > m_atoms.size())
+            compactAtoms();
+    }
+
+    // slow path for the rare case when the energy is requested while the forces are outdated
+    [[nodiscard]] double computePotentialEnergy() const {
+        PeriodicBox box = m_worldData.getPeriodicBox();
+        double potential_energy = 0;
+
+        for (int i = 0; i < m_atoms.size(); ++i) {
+            if (!m_atoms.is_alive[i])
+                continue;
+
+            for (int j = i + 1; j < m_atoms.size(); ++j) {
+                if (!m_atoms.is_alive[j])
+                    continue;
+
+                double dx = m_atoms.x[i] - m_atoms.x[j];
+                double dy = m_atoms.y[i] - m_atoms.y[j];
+
+                box.applyMinimumImage(dx, dy);
+
+                auto &interaction = m_worldData.getInteraction(m_atoms.type[i], m_atoms.type[j]);
+                potential_energy += PairPotential::getShiftedPotential(dx * dx + dy * dy, interaction);
+            }
+
+            if (m_worldData.isCollidingWithWalls()) {
+                auto &wall_interaction = m_worldData.getInteraction(m_atoms.type[i], AtomType::WALL);
+
+                for (double distance: {m_atoms.x[i], m_atoms.y[i], m_worldData.getBoxSize().x - m_atoms.x[i],
+                                       getBoxHeight() - m_atoms.y[i]}) {
+                    potential_energy += LennardJones::getWallPotential(distance, wall_interaction);
+                }
+            }
 
-        delete[] k1;
-        delete[] k2;
-        delete[] k3;
-        delete[] k4;
+            if (m_worldData.isGravityEnabled())
+                potential_energy += GRAVITY * m_atoms.mass[i] * m_atoms.y[i];
+        }
+
+        return potential_energy;
     }
 
-    bool isOutside(const Atom &atom) {
-        if (atom.position.x <= 0 || atom.position.x >= m_worldData.getBoxSize().x)
+    bool isOutside(int i) {
+        // atoms with broken coordinates are lost as well
+        if (!FloatBits::isFinite(m_atoms.x[i]) || !FloatBits::isFinite(m_atoms.y[i]))
+            return true;
+
+        if (m_atoms.x[i] <= 0 || m_atoms.x[i] >= m_worldData.getBoxSize().x)
             return true;
 
-        if (atom.position.y <= 0 || atom.position.y >= getBoxHeight())
+        if (m_atoms.y[i] <= 0 || m_atoms.y[i] >= getBoxHeight())
             return true;
 
         return false;
@@ -0,0 +1,98 @@
+#ifndef PHYSICSSIMULATION_WORLDSNAPSHOT_H
+#define PHYSICSSIMULATION_WORLDSNAPSHOT_H
+
+#include "Atom.h"
+#include "ParticleStorage.h"
+#include "World.h"
+
+// Copy of everything drawers and loggers read, taken between frames. Consumers work with the copy
+// on their own threads while the world goes on; the storage is reused, so taking a snapshot
+// of a world with the same number of atoms does not allocate.
+class WorldSnapshot {
+private:
+    int m_iteration{0};
+    double m_time{0.};
+    double m_time_delta{0.};
+
+    double m_kinetic_energy{0.};
+    double m_potential_energy{0.};
+    double m_temperature{0.};
+    double m_virial_pressure{0.};
+    double m_density{0.};
+
+    sf::Vector2d m_box_size;
+    double m_box_height{0.};
+
+    ParticleStorage m_atoms;
+
+public:
+    // the observables are taken from the last sample, see World::updateObservables
+    void assign(const World &world, int iteration) {
+        m_iteration = iteration;
+        m_time = world.getTime();
+        m_time_delta = world.getTimeDelta();
+
+        m_kinetic_energy = world.getKineticEnergy();
+        m_potential_energy = world.getPotentialEnergy();
+        m_temperature = world.getTemperature();
+        m_virial_pressure = world.getVirialPressure();
+        m_density = world.getDensity();
+
+        m_box_size = world.getWorldData().getBoxSize();
+        m_box_height = world.getBoxHeight();
+
+        m_atoms = world.getAtoms();
+    }
+
+    [[nodiscard]] int getIteration() const {
+        return m_iteration;
+    }
+
+    [[nodiscard]] double getTime() const {
+        return m_time;
+    }
+
+    [[nodiscard]] double getTimeDelta() const {
+        return m_time_delta;
+    }
+
+    [[nodiscard]] double getKineticEnergy() const {
+        return m_kinetic_energy;
+    }
+
+    [[nodiscard]] double getPotentialEnergy() const {
+        return m_potential_energy;
+    }
+
+    [[nodiscard]] double getTotalEnergy() const {
+        return m_kinetic_energy + m_potential_energy;
+    }
+
+    [[nodiscard]] double getTemperature() const {
+        return m_temperature;
+    }
+
+    [[nodiscard]] double getVirialPressure() const {
+        return m_virial_pressure;
+    }
+
+    [[nodiscard]] double getDensity() const {
+        return m_density;
+    }
+
+    [[nodiscard]] const sf::Vector2d &getBoxSize() const {
+        return m_box_size;
+    }
+
+    // lower than the box when the moving wall is inside it
+    [[nodiscard]] double getBoxHeight() const {
+        return m_box_height;
+    }
+
+    [[nodiscard]] const ParticleStorage &getAtoms() const {
+        return m_atoms;
+    }
+};
+
+
+#endif //PHYSICSSIMULATION_WORLDSNAPSHOT_H
@@ -0,0 +1,1030 @@
+#include "Simulation.h"
+#include "Drawers/AtomVertexBatch.h"
+#include "Drawers/ImageDrawer.h"
+#include "World.h"
+#include "Helpers/TrajectoryFile.h"
+#include "Helpers/FloatBits.h"
+#include "Loggers/FileLogger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <thread>
+#include <tuple>
+
+// every allocation of the benchmark is counted, so that the step counters can be checked against them
+std::atomic<long long> g_allocations_count{0};
+
+void *operator new(size_t size) {
+    g_allocations_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (void *pointer = std::malloc(size == 0 ? 1 : size))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+// aligned blocks keep the pointer returned by malloc right before them, aligned_alloc is missing on Windows
+void *operator new(size_t size, std::align_val_t alignment) {
+    g_allocations_count.fetch_add(1, std::memory_order_relaxed);
+
+    void *block = std::malloc(size + (size_t) alignment + sizeof(void *));
+
+    if (!block)
+        throw std::bad_alloc();
+
+    auto address = reinterpret_cast<uintptr_t>(block) + sizeof(void *);
+    auto *pointer = reinterpret_cast<void **>((address + (size_t) alignment - 1) & ~((uintptr_t) alignment - 1));
+
+    pointer[-1] = block;
+
+    return pointer;
+}
+
+[[gnu::noinline]] void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, std::align_val_t) noexcept {
+    if (pointer)
+        std::free(static_cast<void **>(pointer)[-1]);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, size_t, std::align_val_t) noexcept {
+    if (pointer)
+        std::free(static_cast<void **>(pointer)[-1]);
+}
+
+// Atoms on a square lattice slightly wider than the potential minimum with small random speeds.
+std::function<void(std::vector<Atom> &)> getLatticeGenerator(int side, double spacing) {
+    return [side, spacing](std::vector<Atom> &atoms) {
+        for (int x = 0; x < side; ++x) {
+            for (int y = 0; y < side; ++y) {
+                auto &atom = atoms.emplace_back();
+
+                atom.position = {spacing * (x + 0.5), spacing * (y + 0.5)};
+                atom.speed = {Random::get().d(2.) - 1., Random::get().d(2.) - 1.};
+            }
+        }
+    };
+}
+
+void setUpWorld(World &world, int side, double spacing) {
+    world.getWorldData().setBoxSize({side * spacing, side * spacing});
+    world.getWorldData().setIsCollidingWithWalls(false);
+    world.getWorldData().setIsCollidingWithMovingWall(false);
+    world.getWorldData().setIsGravityEnabled(false);
+    world.getWorldData().setTimeDelta(0.001);
+}
+
+// returns average wall-clock time of one simulation step in milliseconds
+double measureStep(World &world, int steps) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < steps; ++i) {
+        world.makeSimulationStep();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / steps;
+}
+
+void benchmarkCellList() {
+    std::cout << "Cell list vs brute force" << std::endl;
+
+    const double spacing = 60;
+
+    for (int side: {16, 32, 64, 128}) {
+        auto generator = getLatticeGenerator(side, spacing);
+
+        World brute_force_world(generator);
+        setUpWorld(brute_force_world, side, spacing);
+        brute_force_world.getWorldData().setIsUsingCellList(false);
+
+        World cell_list_world([&](std::vector<Atom> &atoms) {
+            atoms = brute_force_world.getAtoms().toVector();
+        });
+        setUpWorld(cell_list_world, side, spacing);
+        cell_list_world.getWorldData().setIsUsingCellList(true);
+
+        // the largest worlds are too slow for the brute force path
+        int steps = side <= 32 ? 20 : 2;
+
+        double brute_force_time = measureStep(brute_force_world, steps);
+        double cell_list_time = measureStep(cell_list_world, steps);
+
+        double max_deviation = 0;
+
+        for (int i = 0; i < brute_force_world.getAtoms().size(); ++i) {
+            auto delta = brute_force_world.getAtoms().getPosition(i) - cell_list_world.getAtoms().getPosition(i);
+            max_deviation = std::max({max_deviation, std::abs(delta.x), std::abs(delta.y)});
+        }
+
+        std::cout << std::setw(8) << side * side << " atoms: "
+                  << "brute force " << brute_force_time << " ms/step, "
+                  << "cell list " << cell_list_time << " ms/step, "
+                  << "speedup " << brute_force_time / cell_list_time << ", "
+                  << "max position deviation " << std::scientific << max_deviation << std::fixed << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkNeighbourList() {
+    std::cout << "Neighbour list vs cell list" << std::endl;
+
+    const double spacing = 55;
+    const int steps = 20;
+
+    for (int side: {32, 64, 128}) {
+        auto generator = getLatticeGenerator(side, spacing);
+
+        World cell_list_world(generator);
+        setUpWorld(cell_list_world, side, spacing);
+
+        World neighbour_list_world([&](std::vector<Atom> &atoms) {
+            atoms = cell_list_world.getAtoms().toVector();
+        });
+        setUpWorld(neighbour_list_world, side, spacing);
+        neighbour_list_world.getWorldData().setIsUsingNeighbourList(true);
+
+        double cell_list_time = measureStep(cell_list_world, steps);
+        double neighbour_list_time = measureStep(neighbour_list_world, steps);
+
+        auto &statistics = neighbour_list_world.getNeighbourListStatistics();
+
+        std::cout << std::setw(8) << side * side << " atoms: "
+                  << "cell list " << cell_list_time << " ms/step, "
+                  << "neighbour list " << neighbour_list_time << " ms/step, "
+                  << "rebuilds " << statistics.rebuilds_count << ", "
+                  << "evaluations per rebuild " << statistics.getAverageEvaluationsPerRebuild() << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkThreadPool() {
+    std::cout << "Thread pool vs spawning threads per force evaluation" << std::endl;
+
+    const int rounds = 2000;
+
+    for (unsigned int threads_count: {2u, 4u, 8u}) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (int round = 0; round < rounds; ++round) {
+            std::vector<std::thread> threads;
+
+            for (unsigned int i = 0; i < threads_count; ++i) {
+                threads.emplace_back([] {});
+            }
+
+            for (auto &thread: threads) {
+                thread.join();
+            }
+        }
+
+        auto middle = std::chrono::steady_clock::now();
+
+        {
+            ThreadPool pool(threads_count);
+
+            for (int round = 0; round < rounds; ++round) {
+                pool.run([](unsigned int) {});
+            }
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        // RK4 makes four force evaluations per step
+        std::cout << std::setw(8) << threads_count << " threads: overhead per step: "
+                  << "spawning " << 4 * std::chrono::duration<double, std::micro>(middle - start).count() / rounds
+                  << " us, pool " << 4 * std::chrono::duration<double, std::micro>(end - middle).count() / rounds
+                  << " us" << std::endl;
+    }
+
+    const double spacing = 60;
+
+    for (int side: {4, 8, 16}) {
+        World world(getLatticeGenerator(side, spacing));
+        setUpWorld(world, side, spacing);
+
+        std::cout << std::setw(8) << side * side << " atoms: " << measureStep(world, 1000) << " ms/step" << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkForceAccumulation() {
+    std::cout << "Force accumulation scaling" << std::endl;
+
+    const double spacing = 55;
+    const int side = 128;
+
+    auto generator = getLatticeGenerator(side, spacing);
+
+    // Counts beyond the hardware are measured too: the total busy time of all threads shows whether the work
+    // grows with the number of threads, which would stop the scaling on a machine with that many cores.
+    for (auto accumulation: {ForceAccumulation::PER_THREAD_BUFFERS, ForceAccumulation::OWNER_COMPUTES}) {
+        for (unsigned int threads_count = 1; threads_count <= 64; threads_count *= 2) {
+            World world(generator);
+            setUpWorld(world, side, spacing);
+            world.getWorldData().setIsUsingNeighbourList(true);
+            world.getWorldData().setForceAccumulation(accumulation);
+            world.getWorldData().setThreadsCount(threads_count);
+
+            world.makeSimulationStep();
+            world.resetThreadPoolStatistics();
+
+            const int steps = 10;
+            double step_time = measureStep(world, steps);
+            auto statistics = world.getThreadPoolStatistics();
+
+            double busy_seconds = 0;
+            double max_busy_seconds = 0;
+
+            for (double seconds: statistics.busy_seconds) {
+                busy_seconds += seconds;
+                max_busy_seconds = std::max(max_busy_seconds, seconds);
+            }
+
+            std::cout << std::setw(8) << threads_count << " threads, "
+                      << (accumulation == ForceAccumulation::OWNER_COMPUTES ? "owner computes: " : "per thread buffers: ")
+                      << step_time << " ms/step, all threads busy " << busy_seconds * 1000 / steps
+                      << " ms/step, busiest thread " << max_busy_seconds * 1000 / steps << " ms/step" << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkWorkScheduling() {
+    std::cout << "Work scheduling of the pair loop" << std::endl;
+
+    const double spacing = 55;
+    const int side = 64;
+    const unsigned int threads_count = std::max(4u, std::thread::hardware_concurrency());
+
+    auto generator = getLatticeGenerator(side, spacing);
+
+    std::pair<WorkScheduling, const char *> schedulings[] = {
+            {WorkScheduling::EQUAL,          "equal"},
+            {WorkScheduling::COST_WEIGHTED,  "cost weighted"},
+            {WorkScheduling::DYNAMIC_CHUNKS, "dynamic chunks"}
+    };
+
+    for (bool is_using_cell_list: {false, true}) {
+        for (auto [scheduling, name]: schedulings) {
+            World world(generator);
+            setUpWorld(world, side, spacing);
+            world.getWorldData().setIsUsingCellList(is_using_cell_list);
+            world.getWorldData().setWorkScheduling(scheduling);
+            world.getWorldData().setThreadsCount(threads_count);
+
+            world.makeSimulationStep();
+            world.resetThreadPoolStatistics();
+
+            double step_time = measureStep(world, is_using_cell_list ? 20 : 2);
+            auto statistics = world.getThreadPoolStatistics();
+
+            std::cout << (is_using_cell_list ? "cell list, " : "brute force, ") << name << ": "
+                      << step_time << " ms/step, imbalance " << statistics.getImbalance() << std::endl;
+
+            for (unsigned int thread = 0; thread < threads_count; ++thread) {
+                std::cout << "    thread " << thread << ": busy " << statistics.busy_seconds[thread] * 1000
+                          << " ms, idle " << statistics.getIdleSeconds(thread) * 1000 << " ms" << std::endl;
+            }
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkParticleLayout() {
+    std::cout << "Array of structures vs structure of arrays in the force loop" << std::endl;
+
+    const double spacing = 55;
+    const int side = 256;
+    const int repeats = 20;
+
+    std::vector<Atom> atoms;
+    getLatticeGenerator(side, spacing)(atoms);
+
+    // shuffled atoms make neighbour accesses spread over memory as in a long run
+    std::shuffle(atoms.begin(), atoms.end(), Random::get());
+
+    ParticleStorage particles(atoms);
+    InteractionInfo interaction(48, 1000);
+
+    PeriodicBox box({side * spacing, side * spacing}, false);
+
+    CellList cell_list;
+    cell_list.build(particles, 2.5 * 48 + 15, box);
+
+    NeighbourList neighbour_list;
+    neighbour_list.build(particles, cell_list, 2.5 * 48 + 15, true, box);
+
+    auto measure = [&](auto &&get_delta) {
+        std::vector<sf::Vector2d> forces(atoms.size());
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            for (int i = 0; i < atoms.size(); ++i) {
+                sf::Vector2d force;
+
+                neighbour_list.forEachNeighbour(i, [&](int j) {
+                    sf::Vector2d delta = get_delta(i, j);
+                    force += LennardJones::getForce(delta.x * delta.x + delta.y * delta.y, interaction) * delta;
+                });
+
+                forces[i] = force;
+            }
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double>(end - start).count() / repeats;
+    };
+
+    double aos_time = measure([&](int i, int j) {
+        return atoms[i].position - atoms[j].position;
+    });
+
+    double soa_time = measure([&](int i, int j) {
+        return sf::Vector2d(particles.x[i] - particles.x[j], particles.y[i] - particles.y[j]);
+    });
+
+    // every visited neighbour pulls its whole record in AoS and only two doubles in SoA
+    double pairs = 0;
+
+    for (int i = 0; i < atoms.size(); ++i) {
+        pairs += neighbour_list.getNeighboursCount(i);
+    }
+
+    std::cout << std::setw(8) << atoms.size() << " atoms: "
+              << "AoS " << aos_time * 1000 << " ms, " << pairs * sizeof(Atom) / 1e6 << " MB loaded, "
+              << "SoA " << soa_time * 1000 << " ms, " << pairs * 2 * sizeof(double) / 1e6 << " MB loaded"
+              << std::endl;
+
+    std::cout << std::endl;
+}
+
+void benchmarkLennardJonesKernel() {
+    std::cout << "Vectorized Lennard-Jones kernel" << std::endl;
+
+    // error allowed against LennardJones::getForce, relative to the magnitude of the attractive term,
+    // because the two terms cancel out near the potential minimum
+    const double tolerance = 1e-12;
+    const size_t pairs_count = 1 << 12;
+    const int repeats = 2000;
+
+    InteractionInfo interaction(48, 1000);
+
+    PairBatch batch;
+    batch.reserve(pairs_count);
+    batch.size = pairs_count;
+    batch.is_uniform = false;
+
+    for (size_t k = 0; k < pairs_count; ++k) {
+        double distance = interaction.SIGMA * (0.8 + Random::get().d(2.2));
+
+        batch.distance_sqr[k] = distance * distance;
+        batch.sigma_sixth_power[k] = interaction.SIGMA_SIXTH_POWER;
+        batch.coeff[k] = interaction.COEFF;
+        batch.cutoff_sqr[k] = interaction.CUTOFF_SQR;
+    }
+
+    std::pair<SimdLevel, const char *> levels[] = {
+            {SimdLevel::SCALAR, "scalar"},
+            {SimdLevel::AVX2,   "AVX2"},
+            {SimdLevel::AVX512, "AVX-512"}
+    };
+
+    for (auto [level, name]: levels) {
+        if (level > LennardJonesKernel::getBestSimdLevel())
+            continue;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            LennardJonesKernel::compute(batch, level);
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        double max_error = 0;
+
+        for (size_t k = 0; k < pairs_count; ++k) {
+            double expected = LennardJones::getForce(batch.distance_sqr[k], interaction);
+            double scale = std::abs(interaction.COEFF) / std::pow(batch.distance_sqr[k], 4);
+
+            max_error = std::max(max_error, std::abs(batch.force[k] - expected) / scale);
+        }
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        std::cout << std::setw(8) << name << ": " << pairs_count * repeats / seconds / 1e6 << " Mpairs/s, "
+                  << "max relative error " << std::scientific << max_error << std::fixed
+                  << (max_error <= tolerance ? " (ok)" : " (FAILED)") << std::endl;
+    }
+
+    const double spacing = 55;
+    const int side = 128;
+
+    auto generator = getLatticeGenerator(side, spacing);
+
+    for (bool is_using_simd_kernel: {false, true}) {
+        World world(generator);
+        setUpWorld(world, side, spacing);
+        world.getWorldData().setIsUsingNeighbourList(true);
+        world.getWorldData().setIsUsingSimdKernel(is_using_simd_kernel);
+
+        std::cout << std::setw(8) << side * side << " atoms, " << (is_using_simd_kernel ? "batched kernel: " : "pair by pair: ")
+                  << measureStep(world, 10) << " ms/step" << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkStepAllocations() {
+    std::cout << "Step buffer reallocations" << std::endl;
+
+    const int side = 32;
+    const double spacing = 60;
+
+    for (bool is_using_neighbour_list: {false, true}) {
+        World world(getLatticeGenerator(side, spacing));
+        setUpWorld(world, side, spacing);
+        world.getWorldData().setIsUsingNeighbourList(is_using_neighbour_list);
+        world.getWorldData().setIsUsingSimdKernel(is_using_neighbour_list);
+
+        std::cout << (is_using_neighbour_list ? "  neighbour list, vectorized kernel" : "  cell list") << std::endl;
+
+        long long allocations = g_allocations_count;
+        world.makeSimulationStep();
+
+        std::cout << "    first step: " << world.getStepAllocationsCount() << " counted, "
+                  << g_allocations_count - allocations << " real" << std::endl;
+
+        long long steady_allocations = 0;
+        allocations = g_allocations_count;
+
+        for (int i = 0; i < 20; ++i) {
+            world.makeSimulationStep();
+            steady_allocations += world.getStepAllocationsCount();
+        }
+
+        std::cout << "    next 20 steps: " << steady_allocations << " counted, "
+                  << g_allocations_count - allocations << " real" << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkIntegrators() {
+    std::cout << "Runge-Kutta vs velocity Verlet" << std::endl;
+
+    const int side = 32;
+    const double spacing = 60;
+    const int steps = 200;
+
+    auto generator = getLatticeGenerator(side, spacing);
+    World runge_kutta_world(generator);
+
+    World verlet_world([&](std::vector<Atom> &atoms) {
+        atoms = runge_kutta_world.getAtoms().toVector();
+    });
+
+    for (auto [name, world, integrator]: {
+            std::tuple("runge-kutta", &runge_kutta_world, Integrator::RUNGE_KUTTA),
+            std::tuple("verlet", &verlet_world, Integrator::VELOCITY_VERLET)
+    }) {
+        setUpWorld(*world, side, spacing);
+        world->getWorldData().setIntegrator(integrator);
+
+        double start_energy = world->getTotalEnergy();
+        double time = measureStep(*world, steps);
+
+        std::cout << "  " << std::setw(12) << name << ": " << time << " ms/step, relative energy drift "
+                  << std::scientific << (world->getTotalEnergy() - start_energy) / std::abs(start_energy)
+                  << std::fixed << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkPairPotentialTable() {
+    std::cout << "Tabulated pair potentials" << std::endl;
+
+    const size_t pairs_count = 1 << 12;
+    const int repeats = 2000;
+
+    InteractionInfo interaction(48, 1000);
+    auto table = PairPotentialTable::createLennardJones(interaction.SIGMA, interaction.EPSILON);
+
+    std::vector<double> distances_sqr(pairs_count);
+
+    for (auto &distance_sqr: distances_sqr) {
+        double distance = interaction.SIGMA * (0.8 + Random::get().d(1.7));
+        distance_sqr = distance * distance;
+    }
+
+    // errors are relative to the scale of the attractive term, as in the kernel benchmark
+    double max_force_error = 0;
+    double max_energy_error = 0;
+
+    for (double distance_sqr: distances_sqr) {
+        double scale = std::abs(interaction.COEFF) / std::pow(distance_sqr, 4);
+
+        max_force_error = std::max(max_force_error, std::abs(
+                table->getForce(distance_sqr) - LennardJones::getForce(distance_sqr, interaction)) / scale);
+        max_energy_error = std::max(max_energy_error, std::abs(
+                table->getPotential(distance_sqr) - LennardJones::getShiftedPotential(distance_sqr, interaction)) /
+                                                      interaction.EPSILON);
+    }
+
+    std::cout << "  max relative error: force " << std::scientific << max_force_error
+              << ", energy " << max_energy_error << std::fixed << std::endl;
+
+    auto measure = [&](const char *name, auto &&get_force) {
+        double sum = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            for (double distance_sqr: distances_sqr) {
+                sum += get_force(distance_sqr);
+            }
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        // the sum keeps the loop from being thrown away
+        std::cout << "  " << std::setw(20) << name << ": " << pairs_count * repeats / seconds / 1e6
+                  << " Mpairs/s" << (FloatBits::isFinite(sum) ? "" : " (not finite)") << std::endl;
+    };
+
+    auto morse = PairPotentialTable::createMorse(interaction.EPSILON, 6. / interaction.SIGMA,
+                                                 interaction.SIGMA, interaction.CUTOFF);
+
+    measure("analytic LJ", [&](double distance_sqr) { return LennardJones::getForce(distance_sqr, interaction); });
+    measure("tabulated LJ", [&](double distance_sqr) { return table->getForce(distance_sqr); });
+    measure("analytic Morse", [&](double distance_sqr) {
+        double distance = std::sqrt(distance_sqr);
+        double exponent = std::exp(-6. / interaction.SIGMA * (distance - interaction.SIGMA));
+
+        return 2. * 6. / interaction.SIGMA * interaction.EPSILON * (exponent * exponent - exponent) / distance;
+    });
+    measure("tabulated Morse", [&](double distance_sqr) { return morse->getForce(distance_sqr); });
+
+    const int side = 32;
+    const double spacing = 60;
+    const int steps = 200;
+
+    auto generator = getLatticeGenerator(side, spacing);
+
+    for (auto [name, potential]: {
+            std::pair("built-in LJ", std::shared_ptr<const PairPotentialTable>()),
+            std::pair("tabulated LJ", table),
+            std::pair("shifted force LJ",
+                      PairPotentialTable::createShiftedForceLennardJones(interaction.SIGMA, interaction.EPSILON)),
+            std::pair("WCA", PairPotentialTable::createWeeksChandlerAndersen(interaction.SIGMA, interaction.EPSILON)),
+            std::pair("Morse", morse)
+    }) {
+        World world(generator);
+        setUpWorld(world, side, spacing);
+        world.getWorldData().setIntegrator(Integrator::VELOCITY_VERLET);
+        world.getWorldData().setInteraction(AtomType::BODY, AtomType::BODY,
+                                            InteractionInfo(interaction.SIGMA, interaction.EPSILON, potential));
+
+        double start_energy = world.getTotalEnergy();
+        double time = measureStep(world, steps);
+
+        std::cout << "  " << std::setw(20) << name << ": " << time << " ms/step, relative energy drift "
+                  << std::scientific << (world.getTotalEnergy() - start_energy) / std::abs(start_energy)
+                  << std::fixed << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkForceLoopConfigs() {
+    std::cout << "Force loop specialized on settings" << std::endl;
+
+    // low density, so that walls and gravity are a noticeable part of the work
+    const int side = 64;
+    const double spacing = 120;
+    const int steps = 20;
+
+    auto generator = getLatticeGenerator(side, spacing);
+
+    for (auto [name, is_colliding_with_walls, is_gravity_enabled, is_periodic]: {
+            std::tuple("open", false, false, false),
+            std::tuple("walls", true, false, false),
+            std::tuple("gravity", false, true, false),
+            std::tuple("walls, gravity", true, true, false),
+            std::tuple("periodic", false, false, true),
+            std::tuple("periodic, gravity", false, true, true)
+    }) {
+        World world(generator);
+        setUpWorld(world, side, spacing);
+        world.getWorldData().setIntegrator(Integrator::VELOCITY_VERLET);
+        world.getWorldData().setIsCollidingWithWalls(is_colliding_with_walls);
+        world.getWorldData().setIsGravityEnabled(is_gravity_enabled);
+        world.getWorldData().setIsPeriodic(is_periodic);
+
+        std::cout << "  " << std::setw(20) << name << ": " << measureStep(world, steps) << " ms/step" << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkTrajectoryWriter() {
+    std::cout << "Trajectory frames of a million atoms" << std::endl;
+
+    const int side = 1000;
+    const double spacing = 1.2;
+    const int frames = 10;
+
+    std::vector<Atom> atoms;
+    getLatticeGenerator(side, spacing)(atoms);
+
+    // positions off the lattice, so that they are not easier to pack than in a real run
+    for (auto &atom: atoms) {
+        atom.position += {Random::get().d(0.2) - 0.1, Random::get().d(0.2) - 0.1};
+    }
+
+    ParticleStorage storage(atoms);
+    sf::Vector2d box_size{side * spacing, side * spacing};
+
+    auto path = std::filesystem::temp_directory_path() / "benchmark_trajectory.bin";
+
+    for (auto [name, position_step, velocity_step]: {
+            std::tuple("exact", 0., 0.),
+            std::tuple("step 1e-3", 1e-3, 1e-3),
+            std::tuple("step 1e-2", 1e-2, 1e-2)
+    }) {
+        std::filesystem::remove(path);
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t file_size;
+
+        {
+            TrajectoryWriter writer(path, position_step, velocity_step);
+
+            for (int frame = 0; frame < frames; ++frame) {
+                writer.write(storage, frame, frame, box_size);
+            }
+
+            writer.wait();
+            file_size = writer.getFileSize();
+        }
+
+        auto middle = std::chrono::steady_clock::now();
+
+        TrajectoryReader reader(path);
+        TrajectoryFrame frame;
+
+        // frames in reverse order, as a seeking analysis would read them
+        for (size_t k = reader.getFramesCount(); k-- > 0;) {
+            reader.readFrame(k, frame);
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << "  " << std::setw(10) << name << ": "
+                  << (double) file_size / frames / atoms.size() << " bytes/atom, write "
+                  << std::chrono::duration<double, std::milli>(middle - start).count() / frames << " ms/frame, read "
+                  << std::chrono::duration<double, std::milli>(end - middle).count() / frames << " ms/frame"
+                  << std::endl;
+    }
+
+    std::filesystem::remove(path);
+
+    std::cout << std::endl;
+}
+
+void benchmarkFileLogger() {
+    std::cout << "Logging cost on the simulation thread" << std::endl;
+
+    const int side = 32;
+    const double spacing = 60;
+    const int calls = 20000;
+
+    World world(getLatticeGenerator(side, spacing));
+    setUpWorld(world, side, spacing);
+    world.updateObservables();
+
+    // the observables are computed once when the snapshot is taken, the logger only copies them
+    WorldSnapshot snapshot;
+    snapshot.assign(world, 0);
+
+    auto path = std::filesystem::temp_directory_path() / "benchmark_log.txt";
+
+    // what the logger used to do: open the file, format with iostream and close it on every call
+    std::filesystem::remove(path);
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < calls; ++i) {
+        std::ofstream file(path, std::ios_base::app);
+
+        file << std::setprecision(9) << i << "\t" << world.getTime() << "\t" << world.getTotalEnergy() << "\t"
+             << world.getTemperature() << "\t" << world.getVirialPressure() << "\t" << world.getDensity() << "\n";
+    }
+
+    double reopening_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "  " << std::setw(18) << "reopening" << ": " << reopening_seconds / calls * 1e6 << " us/call"
+              << std::endl;
+
+    for (auto [name, durability]: {
+            std::tuple("buffered", LogDurability::BUFFERED),
+            std::tuple("flushed", LogDurability::FLUSHED),
+            std::tuple("synced", LogDurability::SYNCED)
+    }) {
+        std::filesystem::remove(path);
+
+        FileLogger logger(path, std::chrono::milliseconds(100), durability);
+
+        for (int i = 0; i < calls; ++i) {
+            logger.log(snapshot);
+        }
+
+        logger.flush();
+
+        auto statistics = logger.getStatistics();
+
+        std::cout << "  " << std::setw(18) << name << ": " << statistics.getAverageSeconds() * 1e6 << " us/call, max "
+                  << statistics.max_seconds * 1e6 << " us, " << statistics.flushes_count << " flushes, "
+                  << statistics.stalls_count << " stalls" << std::endl;
+    }
+
+    std::filesystem::remove(path);
+
+    std::cout << std::endl;
+}
+
+// stands for a consumer that is slower than the world, like a drawer encoding images
+class SlowLogger : public Logger {
+private:
+    std::chrono::milliseconds m_delay;
+
+public:
+    explicit SlowLogger(std::chrono::milliseconds delay) : m_delay(delay) {}
+
+    void log(const WorldSnapshot &snapshot) override {
+        std::this_thread::sleep_for(m_delay);
+    }
+};
+
+void benchmarkSnapshotPipeline() {
+    std::cout << "World with a slow consumer" << std::endl;
+
+    const int side = 24;
+    const double spacing = 60;
+    const int iterations_per_frame = 20;
+    const int frames = 40;
+
+    for (auto [name, is_pipelined, policy]: {
+            std::tuple("sequential", false, FrameDropPolicy::WAIT),
+            std::tuple("pipelined, wait", true, FrameDropPolicy::WAIT),
+            std::tuple("pipelined, drop", true, FrameDropPolicy::DROP_OLDEST)
+    }) {
+        for (int delay: {0, 20}) {
+            Simulation simulation(getLatticeGenerator(side, spacing));
+            setUpWorld(simulation.getWorld(), side, spacing);
+
+            simulation.setIterationsPerFrame(iterations_per_frame);
+            simulation.setIsPipelined(is_pipelined);
+            simulation.setFrameDropPolicies(FrameDropPolicy::DROP_OLDEST, policy);
+            simulation.addLogger<SlowLogger>(std::chrono::milliseconds(delay));
+
+            auto start = std::chrono::steady_clock::now();
+
+            simulation.startSimulationForIterationsCount(iterations_per_frame * frames);
+
+            double milliseconds = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+
+            std::cout << "  " << std::setw(16) << name << ", consumer " << std::setw(2) << delay << " ms: "
+                      << milliseconds / frames << " ms/frame, " << simulation.getLogStatistics().dropped_count
+                      << " frames dropped" << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkAtomVertexBatch() {
+    std::cout << "Vertices of a frame built in one pass" << std::endl;
+
+    const double spacing = 12;
+    const int frames = 20;
+
+    for (int side: {316, 1000}) {
+        ParticleStorage atoms;
+        std::vector<Atom> lattice;
+        getLatticeGenerator(side, spacing)(lattice);
+        atoms.assign(lattice);
+
+        float box = (float) (side * spacing);
+
+        // the whole box on an 800 pixels wide window, where atoms become points, and a zoomed in corner
+        for (auto [name, area]: {
+                std::tuple("whole box", sf::FloatRect(0, 0, box, box)),
+                std::tuple("corner", sf::FloatRect(0, 0, 800, 600))
+        }) {
+            AtomVertexBatch batch;
+
+            auto start = std::chrono::steady_clock::now();
+
+            for (int frame = 0; frame < frames; ++frame) {
+                batch.build(atoms, area, area.width / 800.f);
+            }
+
+            double milliseconds = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count() / frames;
+
+            std::cout << "  " << std::setw(8) << atoms.size() << " atoms, " << std::setw(9) << name << ": "
+                      << milliseconds << " ms/frame, " << batch.getAtomsCount() << " visible"
+                      << (batch.isUsingPoints() ? " as points" : " as quads") << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+void benchmarkImageDrawer() {
+    std::cout << "Frames of ImageDrawer" << std::endl;
+
+    const double spacing = 1;
+    const int frames = 10;
+    const sf::Vector2u size(800, 800);
+
+    auto directory = std::filesystem::temp_directory_path() / "benchmark_images";
+    std::filesystem::create_directories(directory);
+
+    // on a single core both candidates are one thread
+    std::vector<unsigned int> threads_counts = {1u, std::max(1u, std::thread::hardware_concurrency())};
+    std::sort(threads_counts.begin(), threads_counts.end());
+    threads_counts.erase(std::unique(threads_counts.begin(), threads_counts.end()), threads_counts.end());
+
+    for (int side: {100, 316}) {
+        ParticleStorage atoms;
+        std::vector<Atom> lattice;
+        getLatticeGenerator(side, spacing)(lattice);
+        atoms.assign(lattice);
+
+        // the lattice ends up inside the image
+        sf::Vector2d box_size(side * spacing * 2.7, side * spacing * 2.7);
+
+        // every atom as a shape checking every pixel of its bounding box, as the images were drawn before
+        std::vector<sf::Uint8> pixels((size_t) size.x * size.y * 4);
+        PixelCanvas canvas(pixels.data(), size);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int frame = 0; frame < frames; ++frame) {
+            canvas.clearRows(0, size.y);
+
+            for (size_t i = 0; i < atoms.size(); ++i) {
+                Circle atom_shape;
+                atom_shape.setRadius(5.f);
+                atom_shape.setOrigin(5.f, 5.f);
+                atom_shape.setPosition(250 + (float) (atoms.x[i] / box_size.x * size.x),
+                                       500 + (float) (atoms.y[i] / box_size.y * size.y));
+                atom_shape.setFillColor(sf::Color::Red);
+                atom_shape.draw(canvas);
+            }
+        }
+
+        double shapes_milliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count() / frames;
+
+        std::cout << "  " << std::setw(6) << atoms.size() << " atoms, per pixel shapes: "
+                  << shapes_milliseconds << " ms/frame" << std::endl;
+
+        for (unsigned int threads_count: threads_counts) {
+            ImageDrawer drawer(size, (directory / "").string(), FrameFormat::JPG, threads_count);
+
+            start = std::chrono::steady_clock::now();
+
+            for (int frame = 0; frame < frames; ++frame) {
+                drawer.startDraw();
+                drawer.drawAtoms(atoms, box_size);
+                drawer.drawBorders(box_size);
+                drawer.endDraw(frame);
+            }
+
+            double drawing_milliseconds = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count() / frames;
+
+            drawer.waitForFrames();
+
+            double total_milliseconds = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count() / frames;
+
+            auto statistics = drawer.getEncoderStatistics();
+
+            std::cout << "  " << std::setw(6) << atoms.size() << " atoms, " << threads_count << " threads: "
+                      << drawing_milliseconds << " ms/frame drawing, " << total_milliseconds
+                      << " ms/frame with encoding, " << 1000 * statistics.encoding_seconds / frames
+                      << " ms/frame encoding in the background" << std::endl;
+        }
+    }
+
+    std::filesystem::remove_all(directory);
+
+    std::cout << std::endl;
+}
+
+// not a benchmark: the guards must work with the -Ofast flags of the project, where std::isfinite may be folded
+void benchmarkNonFinitePositions() {
+    std::cout << "Atoms with non finite positions" << std::endl;
+
+    const int side = 16;
+    const double spacing = 60;
+
+    TimeStepController controller;
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    double infinity = std::numeric_limits<double>::infinity();
+
+    std::cout << "  time step for nan speed: "
+              << (controller.getTimeDelta(0.01, nan, nan) == controller.getMinTimeDelta() ? "ok" : "FAILED")
+              << std::endl;
+
+    for (bool is_using_neighbour_list: {false, true}) {
+        World world(getLatticeGenerator(side, spacing));
+        setUpWorld(world, side, spacing);
+        world.getWorldData().setIsCollidingWithWalls(true);
+        world.getWorldData().setIsUsingNeighbourList(is_using_neighbour_list);
+        world.getWorldData().setIsUsingAdaptiveTimeDelta(true);
+
+        world.makeSimulationStep();
+
+        world.getAtoms().x[0] = nan;
+        world.getAtoms().y[1] = infinity;
+        world.getAtoms().x[2] = -infinity;
+
+        for (int i = 0; i < 10; ++i) {
+            world.makeSimulationStep();
+        }
+
+        auto &atoms = world.getAtoms();
+        bool is_finite = true;
+
+        for (size_t i = 0; i < atoms.size(); ++i) {
+            if (atoms.is_alive[i])
+                is_finite = is_finite && FloatBits::isFinite(atoms.x[i]) && FloatBits::isFinite(atoms.y[i]) &&
+                            FloatBits::isFinite(atoms.vx[i]) && FloatBits::isFinite(atoms.vy[i]);
+        }
+
+        bool are_broken_removed = !atoms.is_alive[0] && !atoms.is_alive[1] && !atoms.is_alive[2];
+
+        std::cout << (is_using_neighbour_list ? "  neighbour list: " : "  cell list: ")
+                  << (are_broken_removed ? "broken atoms removed" : "broken atoms KEPT") << ", "
+                  << world.getLostAtomsCount() << " lost in total, the rest "
+                  << (is_finite ? "finite" : "NOT FINITE") << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+int main() {
+    std::cout.setf(std::ios_base::fixed);
+    std::cout << std::setprecision(3);
+
+    benchmarkCellList();
+    benchmarkNeighbourList();
+    benchmarkThreadPool();
+    benchmarkForceAccumulation();
+    benchmarkWorkScheduling();
+    benchmarkParticleLayout();
+    benchmarkLennardJonesKernel();
+    benchmarkStepAllocations();
+    benchmarkIntegrators();
+    benchmarkPairPotentialTable();
+    benchmarkForceLoopConfigs();
+    benchmarkTrajectoryWriter();
+    benchmarkFileLogger();
+    benchmarkSnapshotPipeline();
+    benchmarkAtomVertexBatch();
+    benchmarkImageDrawer();
+    benchmarkNonFinitePositions();
+
+    return 0;
+}
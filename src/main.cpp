@@ -3,6 +3,7 @@
 #include "Simulation.h"
 #include "Drawers/ImageDrawer.h"
 #include "Loggers/FileLogger.h"
+#include "Loggers/TrajectoryLogger.h"
 
 int main() {
     std::cout.setf(std::ios_base::fixed);
@@ -35,26 +36,36 @@ int main() {
         atoms.emplace_back().position = {226.729, 198.795};
     };
 
-    for (int i = 0; i < 10; i++) {
-        std::cout << std::setprecision(9) << "Start simulation with dt: " << 1. / pow(10, i) << std::endl;
+    Simulation simulation(generator);
 
-        Simulation simulation(generator);
+    // world settings
+    // the step is chosen by the adaptive controller, so there is no need to search for a stable one
+    simulation.getWorldData().setTimeDelta(0.01);
+    simulation.getWorldData().setIsUsingAdaptiveTimeDelta(true);
+    simulation.getWorldData().setIsCollidingWithMovingWall(false);
+    simulation.getWorldData().setIsCollidingWithWalls(false);
+    simulation.getWorldData().setIsGravityEnabled(false);
 
-        // world settings
-        simulation.getWorldData().setTimeDelta(1. / pow(10, i));
-        simulation.getWorldData().setIsCollidingWithMovingWall(false);
-        simulation.getWorldData().setIsCollidingWithWalls(false);
-        simulation.getWorldData().setIsGravityEnabled(false);
+    // a long run is saved periodically and continues from the last checkpoint when restarted
+    if (simulation.loadCheckpoint("../checkpoint.bin"))
+        std::cout << "Resumed from iteration " << simulation.getIteration() << std::endl;
 
-        std::cout << std::setprecision(9) << "Start energy: " << simulation.getWorld().getTotalEnergy() << std::endl;
-        std::cout << std::endl;
+    simulation.setCheckpointing("../checkpoint.bin", 10000);
 
-        simulation.addLogger<TerminalLogger>(simulation.getWorld().getTotalEnergy());
-        simulation.addLogger<FileLogger>("../log.txt");
+    std::cout << std::setprecision(9) << "Start energy: " << simulation.getWorld().getTotalEnergy() << std::endl;
+    std::cout << std::endl;
 
-        simulation.startSimulationForIterationsCount(100000);
+    simulation.addLogger<TerminalLogger>(simulation.getWorld().getTotalEnergy());
+    simulation.addLogger<FileLogger>("../log.txt");
+    simulation.addLogger<TrajectoryLogger>("../trajectory.bin");
 
-        std::cout << std::endl;
+    simulation.startSimulationForIterationsCount(100000);
+
+    std::cout << std::endl << "Time step history:" << std::endl;
+
+    for (auto &record: simulation.getWorld().getTimeDeltaHistory()) {
+        std::cout << std::setprecision(9) << record.iteration << ": time: " << record.time
+                  << "; dt: " << record.dt << std::endl;
     }
 
     return 0;